@@ -5,6 +5,11 @@
 #ifndef BVH_H
 #define BVH_H
 
+#include "ScratchArena.h"
+
+#include <chrono>
+#include <iostream>
+
 #define INF 114514.0
 
 // BVH 树节点
@@ -20,6 +25,14 @@ struct BVHNode_encoded {
     vec3 AA, BB;
 };
 
+// 将 BVH 节点打包为 GPU 纹理缓冲格式
+void EncodeBVHNode(const BVHNode &node, BVHNode_encoded &e) {
+    e.childs = vec3(node.left, node.right, 0);
+    e.leafInfo = vec3(node.n, node.index, 0);
+    e.AA = node.AA;
+    e.BB = node.BB;
+}
+
 // 按照三角形中心排序 -- 比较函数
 bool cmpx(const Triangle &t1, const Triangle &t2) {
     vec3 center1 = (t1.p1 + t1.p2 + t1.p3) / vec3(3, 3, 3);
@@ -142,6 +155,15 @@ int buildBVHwithSAH(std::vector<Triangle> &triangles, std::vector<BVHNode> &node
     }
 
     // 否则递归建树
+    // 前缀/后缀数组从线程临时内存中分配，递归前回退，子节点复用同一段内存
+    ScratchArena &arena = GetThreadScratchArena();
+    ScratchArena::Marker marker = arena.Mark();
+    int count = r - l + 1;
+    vec3 *leftMax = arena.Allocate<vec3>(count);
+    vec3 *leftMin = arena.Allocate<vec3>(count);
+    vec3 *rightMax = arena.Allocate<vec3>(count);
+    vec3 *rightMin = arena.Allocate<vec3>(count);
+
     float Cost = INF;
     int Axis = 0;
     int Split = (l + r) / 2;
@@ -153,8 +175,8 @@ int buildBVHwithSAH(std::vector<Triangle> &triangles, std::vector<BVHNode> &node
 
         // leftMax[i]: [l, i] 中最大的 xyz 值
         // leftMin[i]: [l, i] 中最小的 xyz 值
-        std::vector<vec3> leftMax(r - l + 1, vec3(-INF, -INF, -INF));
-        std::vector<vec3> leftMin(r - l + 1, vec3(INF, INF, INF));
+        std::fill(leftMax, leftMax + count, vec3(-INF, -INF, -INF));
+        std::fill(leftMin, leftMin + count, vec3(INF, INF, INF));
         // 计算前缀 注意 i-l 以对齐到下标 0
         for (int i = l; i <= r; i++) {
             Triangle &t = triangles[i];
@@ -171,8 +193,8 @@ int buildBVHwithSAH(std::vector<Triangle> &triangles, std::vector<BVHNode> &node
 
         // rightMax[i]: [i, r] 中最大的 xyz 值
         // rightMin[i]: [i, r] 中最小的 xyz 值
-        std::vector<vec3> rightMax(r - l + 1, vec3(-INF, -INF, -INF));
-        std::vector<vec3> rightMin(r - l + 1, vec3(INF, INF, INF));
+        std::fill(rightMax, rightMax + count, vec3(-INF, -INF, -INF));
+        std::fill(rightMin, rightMin + count, vec3(INF, INF, INF));
         // 计算后缀 注意 i-l 以对齐到下标 0
         for (int i = r; i >= l; i--) {
             Triangle &t = triangles[i];
@@ -225,6 +247,8 @@ int buildBVHwithSAH(std::vector<Triangle> &triangles, std::vector<BVHNode> &node
         }
     }
 
+    arena.Reset(marker);
+
     // 按最佳轴分割
     if (Axis == 0) std::sort(&triangles[0] + l, &triangles[0] + r + 1, cmpx);
     if (Axis == 1) std::sort(&triangles[0] + l, &triangles[0] + r + 1, cmpy);
@@ -240,4 +264,22 @@ int buildBVHwithSAH(std::vector<Triangle> &triangles, std::vector<BVHNode> &node
     return id;
 }
 
+// 对整个三角形数组构建 SAH BVH，并输出构建耗时与临时内存统计
+int buildBVHwithSAH(std::vector<Triangle> &triangles, std::vector<BVHNode> &nodes, int n) {
+    auto buildStart = std::chrono::high_resolution_clock::now();
+
+    // 根节点所需的前缀/后缀数组最大，一次性按其大小申请
+    ScratchArena &arena = GetThreadScratchArena();
+    arena.ResetStatistics();
+    arena.Reserve(4 * (triangles.size() * sizeof(vec3) + 16));
+
+    int root = buildBVHwithSAH(triangles, nodes, 0, (int) triangles.size() - 1, n);
+
+    auto buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - buildStart);
+    std::cout << "BVH build: " << buildTime.count() << " ms, scratch arena "
+              << arena.allocations << " allocations / " << arena.heapAllocations << " heap allocations, peak "
+              << arena.peakBytes / 1024 << " KB" << std::endl;
+    return root;
+}
+
 #endif //BVH_H
@@ -0,0 +1,175 @@
+#ifndef CPU_TRACER_H
+#define CPU_TRACER_H
+
+#include <glm/glm.hpp>
+
+#include "Triangle.h"
+#include "BVH.h"
+#include "Camera.h"
+#include "Parallel.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// CPU 端的 BVH 遍历，与 shader 中的 hitBVH 使用相同的节点布局（根节点为 1）
+// 三角形通过 TriangleSource 访问，可以是常驻内存的数组，也可以是按块换入的流式数据
+
+struct CPURay {
+    vec3 origin;
+    vec3 direction;
+};
+
+struct CPUHit {
+    bool isHit = false;
+    float distance = INF;
+    int triangle = -1;
+    vec3 normal = vec3(0);
+};
+
+// Möller–Trumbore 三角形求交，t 需大于 tMin 且小于当前最近距离
+bool IntersectTriangle(const CPURay &ray, const vec3 &p1, const vec3 &p2, const vec3 &p3, float tMin, float &t) {
+    vec3 e1 = p2 - p1;
+    vec3 e2 = p3 - p1;
+    vec3 p = cross(ray.direction, e2);
+    float det = dot(e1, p);
+    if (glm::abs(det) < 1e-12f) return false;
+
+    float invDet = 1.0f / det;
+    vec3 s = ray.origin - p1;
+    float u = dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f) return false;
+
+    vec3 q = cross(s, e1);
+    float v = dot(ray.direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f) return false;
+
+    float d = dot(e2, q) * invDet;
+    if (d < tMin || d >= t) return false;
+    t = d;
+    return true;
+}
+
+// 光线与 AABB 求交，返回进入距离，未命中或远于 tMax 时返回 -1
+float IntersectAABB(const CPURay &ray, const vec3 &invDir, const vec3 &AA, const vec3 &BB, float tMax) {
+    vec3 f = (BB - ray.origin) * invDir;
+    vec3 n = (AA - ray.origin) * invDir;
+
+    vec3 tmax = glm::max(f, n);
+    vec3 tmin = glm::min(f, n);
+
+    float t1 = glm::min(tmax.x, glm::min(tmax.y, tmax.z));
+    float t0 = glm::max(tmin.x, glm::max(tmin.y, tmin.z));
+
+    if (t1 < t0 || t1 < 0.0f || t0 > tMax) return -1;
+    return t0 > 0.0f ? t0 : 0.0f;
+}
+
+// 与 [first, first + count) 区间的三角形求交，更新最近交点
+template<typename TriangleGeometry>
+void IntersectTriangles(const CPURay &ray, const TriangleGeometry *tris, int first, int count, CPUHit &hit) {
+    for (int i = 0; i < count; i++) {
+        const TriangleGeometry &t = tris[i];
+        if (IntersectTriangle(ray, t.p1, t.p2, t.p3, 0.0005f, hit.distance)) {
+            hit.isHit = true;
+            hit.triangle = first + i;
+            hit.normal = normalize(cross(t.p2 - t.p1, t.p3 - t.p1));
+        }
+    }
+}
+
+// 常驻内存的三角形数组
+class ResidentTriangles {
+public:
+    explicit ResidentTriangles(const std::vector<Triangle> &triangles) : triangles(triangles) {}
+
+    void Intersect(const CPURay &ray, int first, int count, CPUHit &hit) {
+        IntersectTriangles(ray, &triangles[first], first, count, hit);
+    }
+
+private:
+    const std::vector<Triangle> &triangles;
+};
+
+// 遍历 BVH 求最近交点
+template<typename TriangleSource>
+CPUHit TraceBVH(const std::vector<BVHNode> &nodes, TriangleSource &source, const CPURay &ray) {
+    CPUHit hit;
+    if (nodes.size() < 2) return hit;
+
+    vec3 invDir = vec3(1.0f) / ray.direction;
+
+    int stack[256];
+    int sp = 0;
+    stack[sp++] = 1;
+    while (sp > 0) {
+        const BVHNode &node = nodes[stack[--sp]];
+
+        // 是叶子节点，遍历三角形，求最近交点
+        if (node.n > 0) {
+            source.Intersect(ray, node.index, node.n, hit);
+            continue;
+        }
+
+        // 和左右盒子 AABB 求交，跳过比当前交点更远的盒子
+        float d1 = -1, d2 = -1;
+        if (node.left > 0) d1 = IntersectAABB(ray, invDir, nodes[node.left].AA, nodes[node.left].BB, hit.distance);
+        if (node.right > 0) d2 = IntersectAABB(ray, invDir, nodes[node.right].AA, nodes[node.right].BB, hit.distance);
+
+        // 近的盒子后入栈，先遍历
+        if (d1 >= 0 && d2 >= 0) {
+            if (d1 < d2) {
+                stack[sp++] = node.right;
+                stack[sp++] = node.left;
+            } else {
+                stack[sp++] = node.left;
+                stack[sp++] = node.right;
+            }
+        } else if (d1 >= 0) {
+            stack[sp++] = node.left;
+        } else if (d2 >= 0) {
+            stack[sp++] = node.right;
+        }
+    }
+    return hit;
+}
+
+struct TraversalStats {
+    int rays = 0;
+    int hits = 0;
+    double milliseconds = 0;
+};
+
+// 从相机发射 width x height 条主光线，统计 CPU 遍历性能
+template<typename TriangleSource>
+TraversalStats BenchmarkCPUTraversal(const std::vector<BVHNode> &nodes, TriangleSource &source, const Camera &cam,
+                                     int width, int height) {
+    std::atomic<int> hits(0);
+    auto start = std::chrono::high_resolution_clock::now();
+    ParallelFor(0, height, 8, [&](int rowBegin, int rowEnd) {
+        int localHits = 0;
+        for (int y = rowBegin; y < rowEnd; y++) {
+            for (int x = 0; x < width; x++) {
+                float u = (x + 0.5f) / width;
+                float v = (y + 0.5f) / height;
+                CPURay ray;
+                ray.origin = cam.Position;
+                ray.direction = normalize(cam.LeftBottomCorner + (u * 2.0f * cam.halfW) * cam.Right +
+                                          (v * 2.0f * cam.halfH) * cam.Up);
+                if (TraceBVH(nodes, source, ray).isHit) localHits++;
+            }
+        }
+        hits += localHits;
+    });
+
+    TraversalStats stats;
+    stats.rays = width * height;
+    stats.hits = hits;
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "CPU traversal: " << stats.rays << " rays in " << stats.milliseconds << " ms ("
+              << stats.rays / (stats.milliseconds * 1000.0) << " Mrays/s), " << stats.hits << " hits" << std::endl;
+    return stats;
+}
+
+#endif //CPU_TRACER_H
@@ -0,0 +1,148 @@
+#ifndef ENV_ALIAS_TABLE_H
+#define ENV_ALIAS_TABLE_H
+
+#include "EnvMapFormat.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// HDR 环境贴图的别名表（Walker / Vose alias method）
+// 先按行的边缘分布选行，再按该行的条件分布选列，每一步只需一次查表，采样为 O(1)
+// 表格布局为 width x (height + 1) 的 RGB 数组：
+//   第 i 行 (i < height) 为第 i 行像素的条件分布，R:阈值 q, G:别名列号, B:像素的离散概率 pdf(i, j)
+//   第 height 行的前 height 个元素为行的边缘分布，R:阈值 q, G:别名行号, B:该行的概率
+// 等距柱状投影的 HDR 宽为高的两倍，最后一行足以容纳边缘分布
+
+// Vose 算法在线性时间内构建 n 个元素的别名表，结果写入 out[3 * k] (q) 和 out[3 * k + 1] (alias)
+// weights 之和为 0 时退化为均匀分布
+void buildAliasTable(const double *weights, int n, float *out, std::vector<double> &scaled,
+                     std::vector<int> &small, std::vector<int> &large) {
+    double sum = 0.0;
+    for (int k = 0; k < n; k++) sum += weights[k];
+
+    scaled.resize(n);
+    small.clear();
+    large.clear();
+    for (int k = 0; k < n; k++) {
+        scaled[k] = sum > 0.0 ? weights[k] * n / sum : 1.0;
+        if (scaled[k] < 1.0) small.push_back(k);
+        else large.push_back(k);
+    }
+
+    // 每次用一个概率不足 1 的元素和一个概率有余的元素配对填满一格
+    while (!small.empty() && !large.empty()) {
+        int s = small.back();
+        small.pop_back();
+        int l = large.back();
+        large.pop_back();
+
+        out[3 * s] = (float) scaled[s];
+        out[3 * s + 1] = (float) l;
+
+        scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+        if (scaled[l] < 1.0) small.push_back(l);
+        else large.push_back(l);
+    }
+
+    // 剩余元素的概率在舍入误差内为 1
+    for (int k: large) {
+        out[3 * k] = 1.0f;
+        out[3 * k + 1] = (float) k;
+    }
+    for (int k: small) {
+        out[3 * k] = 1.0f;
+        out[3 * k + 1] = (float) k;
+    }
+}
+
+// 计算 HDR 贴图的别名表，亮度权重与 calculateHdrCache 相同
+// 行的边缘分布存放在额外的一行中，要求 height <= width（等距柱状投影的贴图为 2:1）
+float *calculateHdrAliasTable(float *HDR, int width, int height) {
+    float *table = new float[(size_t) width * (height + 1) * 3]();
+    float *marginal = table + (size_t) width * height * 3;
+
+    // 每行的亮度及行的总亮度
+    std::vector<double> rowSum(height, 0.0);
+    ParallelFor(0, height, 16, [&](int rowBegin, int rowEnd) {
+        std::vector<double> lum(width);
+        std::vector<double> scaled;
+        std::vector<int> small, large;
+        small.reserve(width);
+        large.reserve(width);
+
+        for (int i = rowBegin; i < rowEnd; i++) {
+            double sum = 0.0;
+            for (int j = 0; j < width; j++) {
+                const float *c = &HDR[3 * ((size_t) i * width + j)];
+                lum[j] = HdrLuminance(c);
+                sum += lum[j];
+            }
+            rowSum[i] = sum;
+
+            float *row = &table[3 * (size_t) i * width];
+            buildAliasTable(lum.data(), width, row, scaled, small, large);
+            for (int j = 0; j < width; j++) row[3 * j + 2] = (float) lum[j];    // 暂存亮度，归一化后为 pdf
+        }
+    });
+
+    double lumSum = 0.0;
+    for (int i = 0; i < height; i++) lumSum += rowSum[i];
+
+    // 行的边缘分布
+    std::vector<double> scaled;
+    std::vector<int> small, large;
+    buildAliasTable(rowSum.data(), height, marginal, scaled, small, large);
+    for (int i = 0; i < height; i++) marginal[3 * i + 2] = lumSum > 0.0 ? (float) (rowSum[i] / lumSum) : 1.0f / height;
+
+    // 像素的离散概率
+    ParallelFor(0, height, 16, [&](int rowBegin, int rowEnd) {
+        for (size_t k = (size_t) rowBegin * width; k < (size_t) rowEnd * width; k++) {
+            float &p = table[3 * k + 2];
+            p = lumSum > 0.0 ? (float) (p / lumSum) : 1.0f / ((float) width * height);
+        }
+    });
+
+    return table;
+}
+
+// 与着色器中 SampleAliasTable 相同的离散采样：xi_1 选行，xi_2 选列
+void SampleHdrAliasTable(const float *table, int width, int height, float xi_1, float xi_2, int &row, int &col) {
+    const float *marginal = table + (size_t) width * height * 3;
+
+    float fy = xi_1 * height;
+    int i = std::min((int) fy, height - 1);
+    row = fy - i < marginal[3 * i] ? i : (int) marginal[3 * i + 1];
+
+    float fx = xi_2 * width;
+    int j = std::min((int) fx, width - 1);
+    const float *entry = &table[3 * ((size_t) row * width + j)];
+    col = fx - j < entry[0] ? j : (int) entry[1];
+}
+
+// 在 CPU 上抽样统计直方图，返回其与 B 通道离散分布之间的总变差距离
+// 样本数远大于像素数时，其期望不超过 sqrt(像素数 / (2 pi samples))；由 EnvSamplingTest 调用
+double ValidateHdrAliasTable(const float *table, int width, int height, size_t samples) {
+    std::vector<unsigned int> histogram((size_t) width * height, 0);
+    std::mt19937 rng(1234567u);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    for (size_t s = 0; s < samples; s++) {
+        int row, col;
+        SampleHdrAliasTable(table, width, height, uniform(rng), uniform(rng), row, col);
+        histogram[(size_t) row * width + col]++;
+    }
+
+    double distance = 0.0;
+    for (size_t k = 0; k < histogram.size(); k++)
+        distance += std::fabs((double) histogram[k] / samples - table[3 * k + 2]);
+    distance *= 0.5;
+
+    std::cout << "HDR alias table validation: " << samples << " samples, total variation distance " << distance
+              << " (expected at most about " << std::sqrt(histogram.size() / (2.0 * 3.14159265358979 * samples)) << ")" << std::endl;
+    return distance;
+}
+
+#endif //ENV_ALIAS_TABLE_H
@@ -0,0 +1,92 @@
+#ifndef ENV_CDF_CACHE_H
+#define ENV_CDF_CACHE_H
+
+#include "EnvMapFormat.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <vector>
+
+// 计算 HDR 贴图相关缓存信息
+// R,G 通道存储样本 (x,y) 而 B 通道存储 pdf(i, j)
+// 所有中间量为一维数组：pdf 直接存放在输出的 B 通道，条件分布函数按列连续存储
+// 各列的条件分布与各行的采样互不依赖，分块并行；每列内部仍按原顺序累加，结果与逐元素串行计算逐位相同
+float *calculateHdrCache(float *HDR, int width, int height) {
+    float *cache = new float[(size_t) width * height * 3];
+    float *pdf = cache + 2;     // pdf(i, j) = pdf[3 * (i * width + j)]
+
+    // 亮度
+    ParallelFor(0, height, 16, [&](int rowBegin, int rowEnd) {
+        for (int i = rowBegin; i < rowEnd; i++) {
+            for (int j = 0; j < width; j++) {
+                size_t k = 3 * ((size_t) i * width + j);
+                pdf[k] = HdrLuminance(&HDR[k]);
+            }
+        }
+    });
+
+    // 总亮度按行优先顺序串行累加，保证与原实现逐位一致
+    float lumSum = 0.0;
+    for (size_t k = 0; k < (size_t) width * height; k++) lumSum += pdf[3 * k];
+
+    // 概率密度归一化
+    ParallelFor(0, height, 16, [&](int rowBegin, int rowEnd) {
+        for (size_t k = (size_t) rowBegin * width; k < (size_t) rowEnd * width; k++) pdf[3 * k] /= lumSum;
+    });
+
+    // 累加每一列得到 x 的边缘概率密度，按列分块，块内逐行累加
+    std::vector<float> pdf_x_margin(width, 0.0f);
+    ParallelFor(0, width, 64, [&](int colBegin, int colEnd) {
+        for (int i = 0; i < height; i++)
+            for (int j = colBegin; j < colEnd; j++)
+                pdf_x_margin[j] += pdf[3 * ((size_t) i * width + j)];
+    });
+
+    // 计算 x 的边缘分布函数
+    std::vector<float> cdf_x_margin = pdf_x_margin;
+    for (int i = 1; i < width; i++)
+        cdf_x_margin[i] += cdf_x_margin[i - 1];
+
+    // y 在 X=x 下的条件分布函数，按列存储：cdf_y_condition[x * height + y]
+    // 条件概率密度 pdf / pdf_x_margin 在累加时即时计算
+    std::vector<float> cdf_y_condition((size_t) width * height);
+    ParallelFor(0, width, 64, [&](int colBegin, int colEnd) {
+        std::vector<float> running(colEnd - colBegin, 0.0f);
+        for (int i = 0; i < height; i++) {
+            for (int j = colBegin; j < colEnd; j++) {
+                float p = pdf[3 * ((size_t) i * width + j)] / pdf_x_margin[j];
+                float &sum = running[j - colBegin];
+                sum = i == 0 ? p : sum + p;
+                cdf_y_condition[(size_t) j * height + i] = sum;
+            }
+        }
+    });
+
+    // 穷举 xi_1, xi_2 预计算样本 xy
+    // xi_1=i/height, xi_2=j/width 时的样本 (x, y) 写入 (i, j) 的 R, G 通道
+    ParallelFor(0, height, 4, [&](int rowBegin, int rowEnd) {
+        for (int i = rowBegin; i < rowEnd; i++) {
+            float xi_1 = float(i) / height;
+
+            // 用 xi_1 在 cdf_x_margin 中 lower bound 得到样本 x，同一行共用
+            int x = std::lower_bound(cdf_x_margin.begin(), cdf_x_margin.end(), xi_1) - cdf_x_margin.begin();
+            x = std::min(x, width - 1);
+            const float *cdf_y = &cdf_y_condition[(size_t) x * height];
+
+            for (int j = 0; j < width; j++) {
+                float xi_2 = float(j) / width;
+
+                // 用 xi_2 在 X=x 的情况下得到样本 y
+                int y = std::lower_bound(cdf_y, cdf_y + height, xi_2) - cdf_y;
+
+                size_t k = 3 * ((size_t) i * width + j);
+                cache[k] = float(x) / width;        // R
+                cache[k + 1] = float(y) / height;   // G
+            }
+        }
+    });
+
+    return cache;
+}
+
+#endif //ENV_CDF_CACHE_H
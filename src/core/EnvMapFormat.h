@@ -0,0 +1,233 @@
+#ifndef ENV_MAP_FORMAT_H
+#define ENV_MAP_FORMAT_H
+
+#include <glad/glad.h>
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// 环境贴图的显存格式与降采样的采样分布
+
+// 环境贴图纹理的存储格式
+#define ENV_MAP_RGB32F  0   // 12 字节 / 像素
+#define ENV_MAP_RGB16F  1   // 6 字节 / 像素，超过 65504 的值被截断
+#define ENV_MAP_RGB9E5  2   // 4 字节 / 像素，三个分量共享指数，超过 65408 的值被截断
+
+// 环境光重要性采样的方式，与着色器中的定义一致
+#define ENV_SAMPLING_CDF    0   // 预计算的 CDF 反查缓存 hdrCache
+#define ENV_SAMPLING_ALIAS  1   // 别名表 hdrAlias
+#define ENV_SAMPLING_MIP    2   // 亮度 mip 金字塔 hdrMip
+
+// HDR 像素的亮度，权重与着色器中的 Luminance 一致（Rec. 709），重要性采样的各种分布都以此为权重
+float HdrLuminance(const float *c) {
+    return 0.212671f * c[0] + 0.715160f * c[1] + 0.072169f * c[2];
+}
+
+// float 转为 half 的位表示，就近舍入，溢出截断为最大有限值，过小的值按非规格化数舍入
+uint16_t FloatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    uint16_t sign = (bits >> 16) & 0x8000;
+    float a = std::fabs(value);
+    if (!(a < 65504.0f)) return sign | 0x7bff;      // 同时处理 inf 与 nan
+    if (a < 6.103515625e-05f) {                     // 非规格化数：以 2^-24 为单位就近舍入
+        return sign | (uint16_t) std::lrint(a * 16777216.0f);
+    }
+    std::memcpy(&bits, &a, 4);
+    uint32_t exponent = (bits >> 23) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+    uint32_t half = (exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;    // 进位可自然进入指数位
+    return sign | (uint16_t) std::min<uint32_t>(half, 0x7bff);
+}
+
+// 按 EXT_texture_shared_exponent 的规则打包 RGB9E5，负值按 0 处理
+uint32_t PackRGB9E5(float r, float g, float b) {
+    const float maxValue = 65408.0f;    // (2^9 - 1) / 2^9 * 2^15
+    r = std::min(std::max(r, 0.0f), maxValue);
+    g = std::min(std::max(g, 0.0f), maxValue);
+    b = std::min(std::max(b, 0.0f), maxValue);
+    float maxc = std::max(r, std::max(g, b));
+
+    int exponent = std::max(-16, (int) std::floor(std::log2(std::max(maxc, 1e-30f)))) + 1 + 15;
+    float denom = std::ldexp(1.0f, exponent - 15 - 9);
+    if ((int) std::floor(maxc / denom + 0.5f) == 512) {
+        exponent++;
+        denom *= 2.0f;
+    }
+
+    uint32_t rm = (uint32_t) std::floor(r / denom + 0.5f);
+    uint32_t gm = (uint32_t) std::floor(g / denom + 0.5f);
+    uint32_t bm = (uint32_t) std::floor(b / denom + 0.5f);
+    return ((uint32_t) exponent << 27) | (bm << 18) | (gm << 9) | rm;
+}
+
+// 每像素字节数，用于估计显存
+size_t GetEnvMapBytesPerPixel(int format) {
+    if (format == ENV_MAP_RGB16F) return 6;
+    if (format == ENV_MAP_RGB9E5) return 4;
+    return 12;
+}
+
+// 将 [rowBegin, rowEnd) 行转为 format 的像素格式写入 dst，转换在 CPU 上并行完成
+void ConvertEnvMapRows(const float *cols, int width, int rowBegin, int rowEnd, int format, void *dst) {
+    const float *src = cols + (size_t) rowBegin * width * 3;
+    size_t rowFloats = (size_t) width * 3;
+    ParallelFor(0, rowEnd - rowBegin, 16, [&](int l, int r) {
+        if (format == ENV_MAP_RGB16F) {
+            auto *half = (uint16_t *) dst;
+            for (size_t k = l * rowFloats; k < r * rowFloats; k++) half[k] = FloatToHalf(src[k]);
+        } else if (format == ENV_MAP_RGB9E5) {
+            auto *packed = (uint32_t *) dst;
+            for (size_t k = (size_t) l * width; k < (size_t) r * width; k++)
+                packed[k] = PackRGB9E5(src[3 * k], src[3 * k + 1], src[3 * k + 2]);
+        } else {
+            std::memcpy((float *) dst + l * rowFloats, src + l * rowFloats, (r - l) * rowFloats * sizeof(float));
+        }
+    });
+}
+
+// 分配 format 格式的环境贴图纹理存储，不写入数据
+GLuint AllocateEnvMapTexture(int width, int height, int format) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (format == ENV_MAP_RGB16F)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_HALF_FLOAT, nullptr);
+    else if (format == ENV_MAP_RGB9E5)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB9_E5, width, height, 0, GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV, nullptr);
+    else
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, width, height, 0, GL_RGB, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+// 分帧上传的环境贴图纹理
+// Begin 只分配纹理存储，之后每次 Step 把若干行转换后直接写入映射的 PBO，再由 PBO 写入纹理，
+// 不在主线程一次性拷贝整张贴图，也不需要整张贴图大小的转换缓冲；cols 需保持有效直到上传完成
+class EnvTextureUpload {
+public:
+    void Begin(const float *cols, int width, int height, int format) {
+        this->cols = cols;
+        this->width = width;
+        this->height = height;
+        this->format = format;
+        row = 0;
+        texture = AllocateEnvMapTexture(width, height, format);
+    }
+
+    // 上传不超过 budget 字节（至少一行），budget 减去实际上传的字节数，全部上传后返回 true
+    bool Step(size_t &budget) {
+        if (row >= height) return true;
+        size_t rowBytes = (size_t) width * GetEnvMapBytesPerPixel(format);
+        int rows = (int) std::min<size_t>(height - row, std::max<size_t>(1, budget / rowBytes));
+        size_t bytes = rows * rowBytes;
+
+        if (pbo == 0) glGenBuffers(1, &pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);     // 丢弃旧存储，避免等待上一次上传
+        void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (dst == nullptr) {
+            std::cout << "ERROR::ENV_MAP::MAP_BUFFER_FAILED" << std::endl;
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            row = height;
+            return true;
+        }
+        ConvertEnvMapRows(cols, width, row, row + rows, format, dst);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        if (format == ENV_MAP_RGB16F)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, width, rows, GL_RGB, GL_HALF_FLOAT, nullptr);
+        else if (format == ENV_MAP_RGB9E5)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, width, rows, GL_RGB, GL_UNSIGNED_INT_5_9_9_9_REV, nullptr);
+        else
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, width, rows, GL_RGB, GL_FLOAT, nullptr);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        row += rows;
+        budget -= std::min(budget, bytes);
+        if (row < height) return false;
+
+        glDeleteBuffers(1, &pbo);
+        pbo = 0;
+        return true;
+    }
+
+    // 上传完成前放弃，删除纹理
+    void Cancel() {
+        glDeleteTextures(1, &texture);
+        glDeleteBuffers(1, &pbo);
+        texture = pbo = 0;
+        row = height;
+    }
+
+    bool Done() const { return row >= height; }
+
+    GLuint Texture() const { return texture; }
+
+    size_t Bytes() const { return (size_t) width * height * GetEnvMapBytesPerPixel(format); }
+
+private:
+    const float *cols = nullptr;
+    int width = 0;
+    int height = 0;
+    int format = ENV_MAP_RGB32F;
+    int row = 0;
+    GLuint texture = 0;
+    GLuint pbo = 0;
+};
+
+// 以 format 指定的格式创建环境贴图纹理，一次上传全部数据
+GLuint CreateEnvMapTexture(const float *cols, int width, int height, int format) {
+    EnvTextureUpload upload;
+    upload.Begin(cols, width, height, format);
+    size_t budget = SIZE_MAX;
+    upload.Step(budget);
+    return upload.Texture();
+}
+
+// 将 HDR 按面积平均降采样为 dstWidth x dstHeight，用于构建低分辨率的采样分布
+// 目标像素覆盖的源像素区间为 [x * width / dstWidth, (x + 1) * width / dstWidth)，不整除时各区间相差至多一个像素
+float *DownsampleHdr(const float *HDR, int width, int height, int dstWidth, int dstHeight) {
+    float *dst = new float[(size_t) dstWidth * dstHeight * 3];
+    ParallelFor(0, dstHeight, 4, [&](int rowBegin, int rowEnd) {
+        for (int y = rowBegin; y < rowEnd; y++) {
+            int y0 = (int) ((int64_t) y * height / dstHeight);
+            int y1 = std::max(y0 + 1, (int) ((int64_t) (y + 1) * height / dstHeight));
+            for (int x = 0; x < dstWidth; x++) {
+                int x0 = (int) ((int64_t) x * width / dstWidth);
+                int x1 = std::max(x0 + 1, (int) ((int64_t) (x + 1) * width / dstWidth));
+                double sum[3] = {0.0, 0.0, 0.0};
+                for (int i = y0; i < y1; i++) {
+                    const float *src = &HDR[3 * ((size_t) i * width + x0)];
+                    for (int j = 0; j < x1 - x0; j++) {
+                        sum[0] += src[3 * j];
+                        sum[1] += src[3 * j + 1];
+                        sum[2] += src[3 * j + 2];
+                    }
+                }
+                double inv = 1.0 / ((double) (y1 - y0) * (x1 - x0));
+                float *out = &dst[3 * ((size_t) y * dstWidth + x)];
+                out[0] = (float) (sum[0] * inv);
+                out[1] = (float) (sum[1] * inv);
+                out[2] = (float) (sum[2] * inv);
+            }
+        }
+    });
+    return dst;
+}
+
+#endif //ENV_MAP_FORMAT_H
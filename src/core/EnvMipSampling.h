@@ -0,0 +1,253 @@
+#ifndef ENV_MIP_SAMPLING_H
+#define ENV_MIP_SAMPLING_H
+
+#include <glad/glad.h>
+
+#include "EnvAliasTable.h"
+#include "EnvMapFormat.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// 基于亮度 mip 金字塔的层次化采样（hierarchical sample warping）
+// 第 0 层为亮度图，每一层为下一层 2x2（或 2x1）子像素的平均值，最高层 1x1
+// 采样时从最高层逐层向下，按子像素的亮度比例选择其一，并将随机数重新缩放到所选区间，O(log n) 次查表
+// 不需要 CDF 表；envAngle 只旋转方向，金字塔不变
+// 只在 envSamplingMethod 为 ENV_SAMPLING_MIP 时构建和上传；切换环境贴图或采样方式时整个重建，不支持局部的增量更新
+// 像素的离散概率为 lum(x, y) / (top * width * height)，top 为最高层的值（全图平均亮度）
+
+class LuminancePyramid {
+public:
+    int width = 0;      // 第 0 层的分辨率，均为 2 的幂
+    int height = 0;
+    std::vector<std::vector<float>> levels;
+
+    // 由 HDR 构建，第 0 层取不超过 maxWidth 和 HDR 分辨率的 2 的幂，分辨率不同时先按面积平均降采样
+    void Build(const float *HDR, int hdrWidth, int hdrHeight, int maxWidth) {
+        width = floorPowerOfTwo(std::min(hdrWidth, maxWidth > 0 ? maxWidth : hdrWidth));
+        height = floorPowerOfTwo(std::max(1, (int) ((int64_t) hdrHeight * width / hdrWidth)));
+
+        const float *source = HDR;
+        float *resampled = nullptr;
+        if (width != hdrWidth || height != hdrHeight) {
+            resampled = DownsampleHdr(HDR, hdrWidth, hdrHeight, width, height);
+            source = resampled;
+        }
+
+        levels.clear();
+        levels.emplace_back((size_t) width * height);
+        std::vector<float> &base = levels[0];
+        ParallelFor(0, height, 16, [&](int rowBegin, int rowEnd) {
+            for (size_t k = (size_t) rowBegin * width; k < (size_t) rowEnd * width; k++)
+                base[k] = HdrLuminance(&source[3 * k]);
+        });
+        delete[] resampled;
+
+        while (LevelWidth(LevelCount() - 1) > 1 || LevelHeight(LevelCount() - 1) > 1) {
+            int level = LevelCount();
+            levels.emplace_back((size_t) LevelWidth(level) * LevelHeight(level));
+            buildLevel(level);
+        }
+    }
+
+    int LevelCount() const { return (int) levels.size(); }
+
+    int LevelWidth(int level) const { return std::max(1, width >> level); }
+
+    int LevelHeight(int level) const { return std::max(1, height >> level); }
+
+    float At(int level, int x, int y) const { return levels[level][(size_t) y * LevelWidth(level) + x]; }
+
+    // 与着色器中 SampleHdrMip 相同的逐层选择，返回第 0 层的像素
+    void Sample(float xi_1, float xi_2, int &x, int &y) const {
+        x = 0;
+        y = 0;
+        for (int level = LevelCount() - 2; level >= 0; level--) {
+            bool splitX = LevelWidth(level) > LevelWidth(level + 1);
+            bool splitY = LevelHeight(level) > LevelHeight(level + 1);
+            x *= splitX ? 2 : 1;
+            y *= splitY ? 2 : 1;
+            if (splitX) {
+                float left = At(level, x, y) + (splitY ? At(level, x, y + 1) : 0.0f);
+                float right = At(level, x + 1, y) + (splitY ? At(level, x + 1, y + 1) : 0.0f);
+                if (choose(left, right, xi_1)) x++;
+            }
+            if (splitY) {
+                if (choose(At(level, x, y), At(level, x, y + 1), xi_2)) y++;
+            }
+        }
+    }
+
+    // 第 0 层像素的离散概率
+    float Pdf(int x, int y) const {
+        float top = levels.back()[0];
+        return top > 0.0f ? At(0, x, y) / (top * width * height) : 1.0f / ((float) width * height);
+    }
+
+    size_t Bytes() const {
+        size_t bytes = 0;
+        for (const std::vector<float> &level: levels) bytes += level.size() * sizeof(float);
+        return bytes;
+    }
+
+private:
+    static int floorPowerOfTwo(int v) {
+        int p = 1;
+        while (p * 2 <= v) p *= 2;
+        return p;
+    }
+
+    // 按 a : b 的比例二选一，xi 缩放到所选区间后复用，返回 true 表示选中 b
+    static bool choose(float a, float b, float &xi) {
+        float sum = a + b;
+        float t = sum > 0.0f ? a / sum : 0.5f;
+        if (xi < t) {
+            xi = xi / t;
+            return false;
+        }
+        xi = std::min((xi - t) / (1.0f - t), 0.99999994f);
+        return true;
+    }
+
+    // 由下一层的子像素求平均
+    void buildLevel(int level) {
+        int sx = LevelWidth(level - 1) / LevelWidth(level);
+        int sy = LevelHeight(level - 1) / LevelHeight(level);
+        int childWidth = LevelWidth(level - 1);
+        const std::vector<float> &child = levels[level - 1];
+        std::vector<float> &parent = levels[level];
+        float inv = 1.0f / (sx * sy);
+        ParallelFor(0, LevelHeight(level), 64, [&](int rowBegin, int rowEnd) {
+            for (int y = rowBegin; y < rowEnd; y++) {
+                for (int x = 0; x < LevelWidth(level); x++) {
+                    float sum = 0.0f;
+                    for (int j = 0; j < sy; j++)
+                        for (int i = 0; i < sx; i++) sum += child[(size_t) (y * sy + j) * childWidth + x * sx + i];
+                    parent[(size_t) y * LevelWidth(level) + x] = sum * inv;
+                }
+            }
+        });
+    }
+};
+
+// 上传为带 mip 的 R32F 纹理，各层由 CPU 端的金字塔逐层写入，着色器中用 texelFetch 读取
+GLuint CreateLuminancePyramidTexture(const LuminancePyramid &pyramid) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int level = 0; level < pyramid.LevelCount(); level++) {
+        glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, pyramid.LevelWidth(level), pyramid.LevelHeight(level), 0, GL_RED,
+                     GL_FLOAT, pyramid.levels[level].data());
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, std::max(0, pyramid.LevelCount() - 1));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+struct EnvSamplerComparison {
+    bool compared = false;          // 金字塔与采样分布的分辨率不同时不比较
+    double maxPdfError = 0.0;       // 金字塔 pdf 相对 CDF 缓存 pdf 的最大相对误差
+    double mipDistance = 0.0;       // 金字塔采样直方图与缓存 pdf 的总变差距离
+    double expectedDistance = 0.0;  // 总变差距离期望的上界 sqrt(像素数 / (2 pi samples))
+};
+
+// 金字塔与其他采样方式的验证与对比，由 EnvSamplingTest 调用
+// 以 CDF 缓存（calculateHdrCache 在同一分辨率下的 B 通道）为参照：
+// 1. 金字塔的离散 pdf 与缓存 pdf 的最大相对误差
+// 2. 金字塔采样直方图与缓存 pdf 的总变差距离
+// 并输出三种采样方式的内存占用和 CPU 上每个样本的耗时（CDF 缓存为一次查表，别名表两次查表，金字塔逐层选择）
+EnvSamplerComparison CompareEnvSamplers(const LuminancePyramid &pyramid, const float *cache, const float *alias,
+                                        int width, int height) {
+    EnvSamplerComparison result;
+    if (pyramid.width != width || pyramid.height != height) {
+        std::cout << "Env sampler comparison skipped: pyramid " << pyramid.width << " x " << pyramid.height
+                  << " differs from the sampling resolution " << width << " x " << height << std::endl;
+        return result;
+    }
+
+    size_t nPixels = (size_t) width * height;
+    double maxError = 0.0;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            double expected = cache[3 * ((size_t) y * width + x) + 2];
+            if (expected > 1e-3 / nPixels)
+                maxError = std::max(maxError, std::fabs(pyramid.Pdf(x, y) - expected) / expected);
+        }
+    }
+
+    size_t samples = nPixels * 64;
+    std::vector<unsigned int> histogram(nPixels, 0);
+    std::mt19937 rng(7654321u);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t s = 0; s < samples; s++) {
+        int x, y;
+        pyramid.Sample(uniform(rng), uniform(rng), x, y);
+        histogram[(size_t) y * width + x]++;
+    }
+    double mipNs = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+
+    double distance = 0.0;
+    for (size_t k = 0; k < nPixels; k++)
+        distance += std::fabs((double) histogram[k] / samples - cache[3 * k + 2]);
+    distance *= 0.5;
+
+    // CDF 缓存按着色器的方式查表（xi_1 对应列、xi_2 对应行的最近像素），同时统计其直方图
+    std::fill(histogram.begin(), histogram.end(), 0);
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t s = 0; s < samples; s++) {
+        int i = std::min((int) (uniform(rng) * height), height - 1);
+        int j = std::min((int) (uniform(rng) * width), width - 1);
+        const float *texel = &cache[3 * ((size_t) i * width + j)];
+        int x = std::min((int) (texel[0] * width + 0.5f), width - 1);
+        int y = std::min((int) (texel[1] * height + 0.5f), height - 1);
+        histogram[(size_t) y * width + x]++;
+    }
+    double cacheNs = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+
+    double cacheDistance = 0.0;
+    for (size_t k = 0; k < nPixels; k++)
+        cacheDistance += std::fabs((double) histogram[k] / samples - cache[3 * k + 2]);
+    cacheDistance *= 0.5;
+
+    // 别名表，计时同样包含随机数的生成
+    size_t checksum = 0;
+
+    start = std::chrono::high_resolution_clock::now();
+    for (size_t s = 0; s < samples; s++) {
+        int row, col;
+        SampleHdrAliasTable(alias, width, height, uniform(rng), uniform(rng), row, col);
+        checksum += row + col;
+    }
+    double aliasNs = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::cout << "Env sampler comparison at " << width << " x " << height << " (" << samples << " samples):" << std::endl;
+    std::cout << "  mip pyramid: max pdf error vs CDF cache " << maxError << ", histogram total variation distance "
+              << distance << " (expected at most about " << std::sqrt(nPixels / (2.0 * 3.14159265358979 * samples))
+              << ")" << std::endl;
+    std::cout << "  CDF cache sampler: histogram total variation distance " << cacheDistance << std::endl;
+    std::cout << "  memory: CDF cache " << nPixels * 12 / 1024 << " KB, alias table " << (nPixels + width) * 12 / 1024
+              << " KB, mip pyramid " << pyramid.Bytes() / 1024 << " KB" << std::endl;
+    std::cout << "  CPU ns / sample: CDF cache " << cacheNs / samples << ", alias table " << aliasNs / samples
+              << ", mip pyramid " << mipNs / samples << " (checksum " << checksum % 10 << ")" << std::endl;
+
+    result.compared = true;
+    result.maxPdfError = maxError;
+    result.mipDistance = distance;
+    result.expectedDistance = std::sqrt(nPixels / (2.0 * 3.14159265358979 * samples));
+    return result;
+}
+
+#endif //ENV_MIP_SAMPLING_H
@@ -0,0 +1,108 @@
+#ifndef ENV_ROTATION_H
+#define ENV_ROTATION_H
+
+#include <glm/glm.hpp>
+
+#include "EnvAliasTable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+// 环境贴图的旋转：绕 y 轴旋转 envAngle 圈
+// 查表前把世界空间的方向变换到贴图空间，采样得到的贴图空间方向再变换回世界空间，
+// 采样、pdf 和颜色查询使用同一个变换；旋转不改变采样分布，绕 y 轴旋转也不改变 sin(theta)，pdf 无需修正
+// 以下函数与着色器中的 envToMap、envToWorld、toSphericalCoord、hdrUvToDirection 一一对应，用于 CPU 端验证
+
+const double ENV_PI = 3.14159265358979323846;
+
+glm::vec3 EnvToMap(const glm::vec3 &v, float envAngle) {
+    float a = (float) (2.0 * ENV_PI) * envAngle;
+    float c = std::cos(a), s = std::sin(a);
+    return glm::vec3(c * v.x - s * v.z, v.y, s * v.x + c * v.z);
+}
+
+glm::vec3 EnvToWorld(const glm::vec3 &v, float envAngle) {
+    float a = (float) (2.0 * ENV_PI) * envAngle;
+    float c = std::cos(a), s = std::sin(a);
+    return glm::vec3(c * v.x + s * v.z, v.y, -s * v.x + c * v.z);
+}
+
+// 世界空间方向转贴图纹理坐标，u 在 [0, 1] 内
+glm::vec2 EnvDirectionToUv(const glm::vec3 &v, float envAngle) {
+    glm::vec3 m = EnvToMap(v, envAngle);
+    float u = std::atan2(m.z, m.x) / (float) (2.0 * ENV_PI) + 0.5f;
+    float t = std::asin(std::max(-1.0f, std::min(1.0f, m.y))) / (float) ENV_PI + 0.5f;
+    return glm::vec2(u, 1.0f - t);
+}
+
+// 贴图纹理坐标转世界空间方向
+glm::vec3 EnvUvToDirection(const glm::vec2 &uv, float envAngle) {
+    float phi = (float) (2.0 * ENV_PI) * (uv.x - 0.5f);
+    float theta = (float) ENV_PI * (0.5f - uv.y);
+    glm::vec3 m(std::cos(theta) * std::cos(phi), std::sin(theta), std::cos(theta) * std::sin(phi));
+    return EnvToWorld(m, envAngle);
+}
+
+// 与着色器 hdrPdf 相同的立体角概率密度，pdf 取自别名表（或 CDF 缓存）的 B 通道
+double EnvSolidAnglePdf(const float *table, int width, int height, const glm::vec3 &L, float envAngle) {
+    glm::vec2 uv = EnvDirectionToUv(L, envAngle);
+    int x = std::min(std::max((int) (uv.x * width), 0), width - 1);
+    int y = std::min(std::max((int) (uv.y * height), 0), height - 1);
+    double sinTheta = std::max(std::sin(ENV_PI * uv.y), 1e-10);
+    return table[3 * ((size_t) y * width + x) + 2] * (double) width * height / (2.0 * ENV_PI * ENV_PI * sinTheta);
+}
+
+struct EnvRotationValidation {
+    double maxIntegralError = 0.0;  // 所有角度中 pdf 积分与 1 的最大偏差
+    int mismatches = 0;             // 所有角度中未落回原像素的样本数
+};
+
+// 旋转一致性验证，由 EnvSamplingTest 调用，对若干 envAngle：
+// 1. 在世界空间的 (theta, phi) 网格上积分立体角 pdf，结果应为 1
+// 2. 用别名表采样像素并在像素内抖动，转为世界方向后再查回纹理坐标，应落回同一像素
+// table 的 B 通道为像素的离散概率；round-trip 采样需要别名表，alias 为空时跳过
+EnvRotationValidation ValidateEnvRotation(const float *table, const float *alias, int width, int height) {
+    const float angles[] = {0.0f, 0.137f, -0.61f, 0.5f, 0.999f};
+    std::mt19937 rng(2468u);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    EnvRotationValidation result;
+    for (float envAngle: angles) {
+        // (theta, phi) 网格上的中点积分，dω = sin(theta) dtheta dphi；网格与旋转后的像素边界不对齐
+        int nPhi = 4 * width + 1, nTheta = 4 * height + 1;
+        double integral = 0.0;
+        for (int i = 0; i < nTheta; i++) {
+            double theta = ENV_PI * (i + 0.5) / nTheta;     // 与 y 轴的夹角
+            double y = std::cos(theta), r = std::sin(theta);
+            for (int j = 0; j < nPhi; j++) {
+                double phi = 2.0 * ENV_PI * (j + 0.5) / nPhi;
+                glm::vec3 L((float) (r * std::cos(phi)), (float) y, (float) (r * std::sin(phi)));
+                integral += EnvSolidAnglePdf(table, width, height, L, envAngle) * r;
+            }
+        }
+        integral *= (ENV_PI / nTheta) * (2.0 * ENV_PI / nPhi);
+        result.maxIntegralError = std::max(result.maxIntegralError, std::fabs(integral - 1.0));
+
+        int mismatches = 0;
+        const int samples = alias ? 1 << 18 : 0;
+        for (int s = 0; s < samples; s++) {
+            int row, col;
+            SampleHdrAliasTable(alias, width, height, uniform(rng), uniform(rng), row, col);
+            glm::vec2 uv((col + 0.01f + 0.98f * uniform(rng)) / width, (row + 0.01f + 0.98f * uniform(rng)) / height);
+            glm::vec2 back = EnvDirectionToUv(EnvUvToDirection(uv, envAngle), envAngle);
+            int x = std::min((int) (back.x * width), width - 1);
+            int y = std::min((int) (back.y * height), height - 1);
+            if (x != col || y != row) mismatches++;
+        }
+
+        result.mismatches += mismatches;
+
+        std::cout << "Env rotation " << envAngle << ": pdf integral " << integral << ", sample round-trip mismatches "
+                  << mismatches << " / " << samples << std::endl;
+    }
+    return result;
+}
+
+#endif //ENV_ROTATION_H
@@ -0,0 +1,154 @@
+#ifndef ENV_SUN_H
+#define ENV_SUN_H
+
+#include <glm/glm.hpp>
+
+#include "EnvMapFormat.h"
+#include "EnvRotation.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// 太阳与天空的分离
+// 晴天 HDR 的大部分能量集中在太阳的几个像素内，按亮度构建的采样分布难以覆盖其余的天空，且太阳像素本身的离散化误差产生萤火虫
+// 导入时把太阳区域提取为解析的圆盘光源，单独按圆锥均匀采样；区域内填入周围天空的颜色，剩余的环境贴图更平滑
+// 太阳的方向在贴图空间中（未旋转），着色器中与环境贴图经过同一个 envAngle 旋转
+
+#define ENV_SUN_MAX_HALF_ANGLE      5.0     // 太阳区域的最大角半径（度），更大的亮区不视为太阳
+#define ENV_SUN_MIN_POWER_FRACTION  0.2     // 太阳至少占整个环境功率的比例
+
+struct EnvSun {
+    bool found = false;
+    glm::vec3 direction = glm::vec3(0, 1, 0);   // 贴图空间中圆盘中心的方向
+    glm::vec3 radiance = glm::vec3(0);          // 圆盘内的辐亮度
+    float cosAngle = 1.0f;                      // 圆盘角半径的余弦
+    float solidAngle = 0.0f;                    // 圆盘的立体角，与提取的像素区域相同
+    float powerFraction = 0.0f;                 // 太阳占整个环境功率（亮度 x 立体角）的比例
+    float sampleProbability = 0.0f;             // 着色器中采样太阳的概率，其余采样环境贴图
+};
+
+// 在 width x height 的 HDR 中寻找太阳并就地移除，HDR 随后作为天空用于显示和构建采样分布
+// 从最亮的像素出发，按 4 邻域（水平方向环绕）扩展亮度不低于 峰值 x threshold 的像素作为太阳区域；
+// 区域的角半径不超过 ENV_SUN_MAX_HALF_ANGLE 且功率占比不低于 ENV_SUN_MIN_POWER_FRACTION 时认为是太阳
+// 区域内的像素替换为区域外一圈像素的平均颜色，多出的能量归入与区域等立体角的圆盘，总功率不变
+EnvSun ExtractHdrSun(float *HDR, int width, int height, float threshold) {
+    EnvSun sun;
+    const double pixelArea = (2.0 * ENV_PI / width) * (ENV_PI / height);
+    const double maxSolidAngle = 2.0 * ENV_PI * (1.0 - std::cos(ENV_SUN_MAX_HALF_ANGLE * ENV_PI / 180.0));
+
+    // 每行像素的立体角 dω = dphi dtheta sin(theta)
+    std::vector<double> rowArea(height);
+    for (int i = 0; i < height; i++) rowArea[i] = pixelArea * std::sin(ENV_PI * (i + 0.5) / height);
+
+    // 各行的功率与最亮的像素
+    std::vector<double> rowPower(height);
+    std::vector<int> rowPeak(height);
+    ParallelFor(0, height, 16, [&](int rowBegin, int rowEnd) {
+        for (int i = rowBegin; i < rowEnd; i++) {
+            double power = 0.0;
+            int peak = 0;
+            float peakLum = -1.0f;
+            for (int j = 0; j < width; j++) {
+                float lum = HdrLuminance(&HDR[3 * ((size_t) i * width + j)]);
+                power += lum;
+                if (lum > peakLum) {
+                    peakLum = lum;
+                    peak = j;
+                }
+            }
+            rowPower[i] = power * rowArea[i];
+            rowPeak[i] = peak;
+        }
+    });
+
+    double totalPower = 0.0;
+    size_t peak = 0;
+    float peakLum = -1.0f;
+    for (int i = 0; i < height; i++) {
+        totalPower += rowPower[i];
+        size_t k = (size_t) i * width + rowPeak[i];
+        float lum = HdrLuminance(&HDR[3 * k]);
+        if (lum > peakLum) {
+            peakLum = lum;
+            peak = k;
+        }
+    }
+    if (!(peakLum > 0.0f) || !(totalPower > 0.0)) return sun;
+
+    // 从最亮的像素扩展太阳区域，mask: 1 为区域内，2 为区域外一圈
+    const float cutoff = peakLum * threshold;
+    std::vector<uint8_t> mask((size_t) width * height, 0);
+    std::vector<size_t> region;
+    std::vector<size_t> stack(1, peak);
+    mask[peak] = 1;
+    double solidAngle = 0.0;
+    while (!stack.empty()) {
+        size_t k = stack.back();
+        stack.pop_back();
+        region.push_back(k);
+        int y = (int) (k / width), x = (int) (k % width);
+        solidAngle += rowArea[y];
+        if (solidAngle > maxSolidAngle) return sun;
+
+        size_t neighbors[4] = {(size_t) y * width + (x + 1) % width, (size_t) y * width + (x + width - 1) % width,
+                               y > 0 ? k - width : k, y + 1 < height ? k + width : k};
+        for (size_t n: neighbors) {
+            if (mask[n] != 0 || HdrLuminance(&HDR[3 * n]) < cutoff) continue;
+            mask[n] = 1;
+            stack.push_back(n);
+        }
+    }
+
+    // 区域外一圈像素的平均颜色作为区域内的天空
+    double sky[3] = {0.0, 0.0, 0.0};
+    size_t ringCount = 0;
+    for (size_t k: region) {
+        int y = (int) (k / width), x = (int) (k % width);
+        size_t neighbors[4] = {(size_t) y * width + (x + 1) % width, (size_t) y * width + (x + width - 1) % width,
+                               y > 0 ? k - width : k, y + 1 < height ? k + width : k};
+        for (size_t n: neighbors) {
+            if (mask[n] != 0) continue;
+            mask[n] = 2;
+            for (int c = 0; c < 3; c++) sky[c] += HDR[3 * n + c];
+            ringCount++;
+        }
+    }
+    for (int c = 0; c < 3; c++) sky[c] = ringCount > 0 ? sky[c] / ringCount : 0.0;
+    float skyColor[3] = {(float) sky[0], (float) sky[1], (float) sky[2]};
+    double skyLum = HdrLuminance(skyColor);
+
+    // 超出天空的部分为太阳：功率、按功率加权的方向
+    double sunPower[3] = {0.0, 0.0, 0.0};
+    double sunDirection[3] = {0.0, 0.0, 0.0};
+    for (size_t k: region) {
+        int y = (int) (k / width), x = (int) (k % width);
+        const float *c = &HDR[3 * k];
+        for (int i = 0; i < 3; i++) sunPower[i] += std::max(c[i] - sky[i], 0.0) * rowArea[y];
+        glm::vec3 dir = EnvUvToDirection(glm::vec2((x + 0.5f) / width, (y + 0.5f) / height), 0.0f);
+        double weight = std::max(HdrLuminance(c) - skyLum, 0.0) * rowArea[y];
+        for (int i = 0; i < 3; i++) sunDirection[i] += dir[i] * weight;
+    }
+    float sunPowerColor[3] = {(float) sunPower[0], (float) sunPower[1], (float) sunPower[2]};
+    double sunLum = HdrLuminance(sunPowerColor);
+    glm::vec3 direction((float) sunDirection[0], (float) sunDirection[1], (float) sunDirection[2]);
+    if (sunLum < ENV_SUN_MIN_POWER_FRACTION * totalPower || glm::length(direction) <= 0.0f) return sun;
+
+    for (size_t k: region)
+        for (int c = 0; c < 3; c++) HDR[3 * k + c] = skyColor[c];
+
+    sun.found = true;
+    sun.direction = glm::normalize(direction);
+    sun.radiance = glm::vec3((float) (sunPower[0] / solidAngle), (float) (sunPower[1] / solidAngle),
+                             (float) (sunPower[2] / solidAngle));
+    sun.cosAngle = (float) (1.0 - solidAngle / (2.0 * ENV_PI));
+    sun.solidAngle = (float) solidAngle;
+    sun.powerFraction = (float) (sunLum / totalPower);
+    sun.sampleProbability = std::min(std::max(sun.powerFraction, 0.1f), 0.9f);
+    return sun;
+}
+
+#endif //ENV_SUN_H
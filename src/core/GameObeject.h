@@ -8,7 +8,7 @@
 class GameObject {
 public:
     bool active = false;
-    TriangleIndex triangleIndex;
+    TriangleIndex triangleIndex{0, 0};
 
     GameObject() { }
 };
@@ -0,0 +1,116 @@
+#ifndef GEOMETRY_CACHE_H
+#define GEOMETRY_CACHE_H
+
+#include "MeshFile.h"
+#include "MappedFile.h"
+#include "MeshSimplify.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 进程内的几何缓存，以源文件路径和修改时间为键
+// 同一文件重复加载时返回同一个只读网格，多个物体共享映射的数据；源文件被修改后重新加载
+// 简化生成的 LOD 与原网格一同缓存
+class GeometryCache {
+public:
+    struct Counters {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    // 加载 srcPath 对应的网格，失败时返回空指针
+    std::shared_ptr<const MeshFile> Load(const std::string &srcPath) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry *entry = load(srcPath, true);
+        return entry ? entry->mesh : nullptr;
+    }
+
+    // 最多 levels 级 LOD，第 i 级约为第 i - 1 级三角形数的 MESH_LOD_RATIO（第 0 级为原网格，不包含在结果中）
+    // 首次请求时逐级简化生成；简化不再明显减少三角形时停止，因此结果可能少于 levels 级
+    std::vector<std::shared_ptr<const MeshLOD>> LoadLODs(const std::string &srcPath, int levels) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry *entry = load(srcPath, false);
+        if (entry == nullptr) return {};
+
+        while ((int) entry->lods.size() < levels && !entry->lodsComplete) {
+            MeshView source = entry->lods.empty() ? entry->mesh->View() : entry->lods.back()->View();
+            size_t sourceTriangles = source.indexCount / 3;
+            std::shared_ptr<MeshLOD> lod = std::make_shared<MeshLOD>();
+            SimplifyMesh(source, (size_t) (sourceTriangles * MESH_LOD_RATIO), *lod);
+            if (lod->TriangleCount() == 0 || lod->TriangleCount() > sourceTriangles * 0.9f) {
+                entry->lodsComplete = true;
+                break;
+            }
+            entry->lods.push_back(lod);
+        }
+
+        int n = std::min(levels, (int) entry->lods.size());
+        return std::vector<std::shared_ptr<const MeshLOD>>(entry->lods.begin(), entry->lods.begin() + n);
+    }
+
+    // 释放只被缓存引用的网格及其 LOD，返回释放的网格数
+    size_t Trim() {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t released = 0;
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (it->second.mesh.use_count() == 1) {
+                it = entries.erase(it);
+                released++;
+            } else {
+                ++it;
+            }
+        }
+        return released;
+    }
+
+    Counters GetCounters() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return counters;
+    }
+
+private:
+    struct Entry {
+        int64_t modified;
+        std::shared_ptr<const MeshFile> mesh;
+        std::vector<std::shared_ptr<const MeshLOD>> lods;
+        bool lodsComplete = false;
+    };
+
+    std::unordered_map<std::string, Entry> entries;
+    Counters counters;
+    std::mutex mutex;
+
+    // 调用者需持有 mutex，count 为 false 时不计入命中统计
+    Entry *load(const std::string &srcPath, bool count) {
+        int64_t modified = GetFileModifiedTime(srcPath);
+        auto it = entries.find(srcPath);
+        if (it != entries.end() && it->second.modified == modified) {
+            if (count) counters.hits++;
+            return &it->second;
+        }
+
+        if (count) counters.misses++;
+        std::shared_ptr<MeshFile> mesh = std::make_shared<MeshFile>();
+        if (!LoadMeshFile(srcPath, *mesh)) {
+            entries.erase(srcPath);
+            return nullptr;
+        }
+        Entry &entry = entries[srcPath];
+        entry = Entry();
+        entry.modified = modified;
+        entry.mesh = mesh;
+        return &entry;
+    }
+};
+
+GeometryCache &GetGeometryCache() {
+    static GeometryCache cache;
+    return cache;
+}
+
+#endif //GEOMETRY_CACHE_H
@@ -0,0 +1,285 @@
+#ifndef GEOMETRY_STREAM_H
+#define GEOMETRY_STREAM_H
+
+#include <glm/glm.hpp>
+
+#include "Triangle.h"
+#include "Material.h"
+#include "MappedFile.h"
+#include "CPUTracer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 流式几何：BVH 构建完成后，按叶子顺序排列的三角形被写入块文件
+// CPU 遍历时 BVH 节点常驻内存，三角形以块为单位从映射文件换入 LRU 缓存
+// 文件头之后为材质表，随后为按页对齐的三角形块
+// 目前只用于 CPU 遍历的基准测试，衡量按块换入的代价；BVH 构建与 GPU 渲染仍需要常驻的三角形数组
+
+#define GEOMETRY_STREAM_MAGIC       0x53475452  // "RTGS"
+#define GEOMETRY_STREAM_VERSION     1
+#define GEOMETRY_STREAM_BLOCK_SIZE  1024        // 每块三角形数量
+#define GEOMETRY_STREAM_PAGE_SIZE   4096
+#define GEOMETRY_STREAM_SHARDS      16          // 缓存按块号分片，各片独立加锁
+
+// 紧凑的三角形几何，材质通过材质表索引
+struct StreamTriangle {
+    vec3 p1, p2, p3;
+    vec3 n1, n2, n3;
+    uint32_t material;
+};
+
+struct GeometryStreamHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t triangleCount;
+    uint32_t blockSize;         // 每块三角形数量
+    uint32_t materialCount;
+    uint32_t blockBytes;        // 每块在文件中占用的字节数（按页对齐）
+    uint64_t materialsOffset;
+    uint64_t blocksOffset;
+};
+
+uint64_t AlignToPage(uint64_t bytes) {
+    return (bytes + GEOMETRY_STREAM_PAGE_SIZE - 1) / GEOMETRY_STREAM_PAGE_SIZE * GEOMETRY_STREAM_PAGE_SIZE;
+}
+
+// 将三角形写入块文件，材质去重后存为材质表
+bool WriteGeometryStream(const std::string &path, const std::vector<Triangle> &triangles) {
+    // 材质去重
+    std::vector<Material> materials;
+    std::vector<uint32_t> materialIds(triangles.size());
+    for (size_t i = 0; i < triangles.size(); i++) {
+        const Material &m = triangles[i].material;
+        uint32_t id = 0;
+        if (!materials.empty() && std::memcmp(&materials[materialIds[i - 1]], &m, sizeof(Material)) == 0) {
+            id = materialIds[i - 1];
+        } else {
+            while (id < materials.size() && std::memcmp(&materials[id], &m, sizeof(Material)) != 0) id++;
+            if (id == materials.size()) materials.push_back(m);
+        }
+        materialIds[i] = id;
+    }
+
+    GeometryStreamHeader header{};
+    header.magic = GEOMETRY_STREAM_MAGIC;
+    header.version = GEOMETRY_STREAM_VERSION;
+    header.triangleCount = triangles.size();
+    header.blockSize = GEOMETRY_STREAM_BLOCK_SIZE;
+    header.materialCount = materials.size();
+    header.blockBytes = AlignToPage(GEOMETRY_STREAM_BLOCK_SIZE * sizeof(StreamTriangle));
+    header.materialsOffset = sizeof(GeometryStreamHeader);
+    header.blocksOffset = AlignToPage(header.materialsOffset + materials.size() * sizeof(Material));
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    std::vector<char> block(header.blockBytes, 0);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(materials.data()), materials.size() * sizeof(Material));
+    file.write(block.data(), header.blocksOffset - header.materialsOffset - materials.size() * sizeof(Material));
+
+    for (size_t first = 0; first < triangles.size(); first += GEOMETRY_STREAM_BLOCK_SIZE) {
+        std::fill(block.begin(), block.end(), 0);
+        auto *dst = reinterpret_cast<StreamTriangle *>(block.data());
+        size_t count = std::min<size_t>(GEOMETRY_STREAM_BLOCK_SIZE, triangles.size() - first);
+        for (size_t i = 0; i < count; i++) {
+            const Triangle &t = triangles[first + i];
+            dst[i].p1 = t.p1;
+            dst[i].p2 = t.p2;
+            dst[i].p3 = t.p3;
+            dst[i].n1 = t.n1;
+            dst[i].n2 = t.n2;
+            dst[i].n3 = t.n3;
+            dst[i].material = materialIds[first + i];
+        }
+        file.write(block.data(), block.size());
+    }
+    file.close();
+
+    if (!file) {
+        std::remove(path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 换入的三角形块
+struct TriangleBlock {
+    std::vector<StreamTriangle> triangles;
+};
+
+// 流式三角形数据：映射块文件，按块换入 LRU 缓存
+// 换入时从映射内存拷贝到缓存，随后通知系统丢弃映射页，缓存的块不超过 cacheBytes
+// 缓存按块号分为 GEOMETRY_STREAM_SHARDS 片，每片有独立的锁和 LRU；拷贝块（可能触发缺页和磁盘读取）时不持有锁，
+// 多个遍历线程只在访问同一片时竞争
+// 总容量按片分配，各片容量之和不超过预算，容量为 0 的片不缓存；遍历线程正在使用的块在预算之外
+class GeometryStream {
+public:
+    // 统计信息
+    struct Counters {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        uint64_t bytesPaged = 0;
+
+        double HitRate() const {
+            uint64_t total = hits + misses;
+            return total == 0 ? 0.0 : (double) hits / total;
+        }
+    };
+
+    bool Open(const std::string &path, size_t cacheBytes) {
+        Close();
+        if (!file.Open(path)) return false;
+
+        if (file.Size() < sizeof(GeometryStreamHeader)) {
+            file.Close();
+            return false;
+        }
+        std::memcpy(&header, file.Data(), sizeof(header));
+        uint64_t blockCount = (header.triangleCount + header.blockSize - 1) / std::max<uint32_t>(header.blockSize, 1);
+        if (header.magic != GEOMETRY_STREAM_MAGIC || header.version != GEOMETRY_STREAM_VERSION ||
+            header.blockSize == 0 || header.blockBytes < header.blockSize * sizeof(StreamTriangle) ||
+            header.materialsOffset + header.materialCount * sizeof(Material) > file.Size() ||
+            header.blocksOffset + blockCount * header.blockBytes > file.Size()) {
+            file.Close();
+            return false;
+        }
+
+        const auto *m = reinterpret_cast<const Material *>(file.Data() + header.materialsOffset);
+        materials.assign(m, m + header.materialCount);
+        size_t blockBytes = header.blockSize * sizeof(StreamTriangle);
+        size_t capacity = cacheBytes / blockBytes;
+        for (size_t i = 0; i < GEOMETRY_STREAM_SHARDS; i++)
+            shards[i].capacity = capacity / GEOMETRY_STREAM_SHARDS + (i < capacity % GEOMETRY_STREAM_SHARDS ? 1 : 0);
+        std::cout << "Geometry stream opened: " << header.triangleCount << " triangles in " << blockCount
+                  << " blocks, cache " << capacity << " blocks (" << capacity * blockBytes / (1024 * 1024) << " MB)"
+                  << std::endl;
+        return true;
+    }
+
+    // 调用时不能有线程正在访问
+    void Close() {
+        for (Shard &shard: shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.cache.clear();
+            shard.lru.clear();
+            shard.counters = Counters();
+        }
+        materials.clear();
+        file.Close();
+    }
+
+    // 获取第 index 块，未命中时从文件换入
+    // 查找和插入在片的锁内进行，拷贝在锁外；两个线程同时换入同一块时，后完成的使用先插入的块
+    std::shared_ptr<const TriangleBlock> GetBlock(uint32_t index) {
+        Shard &shard = shards[index % GEOMETRY_STREAM_SHARDS];
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.cache.find(index);
+            if (it != shard.cache.end()) {
+                shard.counters.hits++;
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second.position);
+                return it->second.block;
+            }
+        }
+
+        uint32_t first = index * header.blockSize;
+        uint32_t count = std::min(header.blockSize, header.triangleCount - first);
+        uint64_t offset = header.blocksOffset + (uint64_t) index * header.blockBytes;
+        const auto *src = reinterpret_cast<const StreamTriangle *>(file.Data() + offset);
+
+        std::shared_ptr<TriangleBlock> block = std::make_shared<TriangleBlock>();
+        block->triangles.assign(src, src + count);
+        file.Evict(offset, header.blockBytes);
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.counters.misses++;
+        shard.counters.bytesPaged += header.blockBytes;
+        auto it = shard.cache.find(index);
+        if (it != shard.cache.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second.position);
+            return it->second.block;
+        }
+        if (shard.capacity == 0) return block;
+
+        if (shard.cache.size() >= shard.capacity) {
+            uint32_t victim = shard.lru.back();
+            shard.lru.pop_back();
+            shard.cache.erase(victim);
+            shard.counters.evictions++;
+        }
+        shard.lru.push_front(index);
+        CacheEntry entry;
+        entry.block = block;
+        entry.position = shard.lru.begin();
+        shard.cache[index] = entry;
+        return block;
+    }
+
+    // 与 [first, first + count) 区间的三角形求交，区间可能跨越多个块
+    void Intersect(const CPURay &ray, int first, int count, CPUHit &hit) {
+        int end = first + count;
+        while (first < end) {
+            uint32_t index = first / header.blockSize;
+            int blockFirst = index * header.blockSize;
+            int blockEnd = std::min<int>(blockFirst + header.blockSize, end);
+            std::shared_ptr<const TriangleBlock> block = GetBlock(index);
+            IntersectTriangles(ray, &block->triangles[first - blockFirst], first, blockEnd - first, hit);
+            first = blockEnd;
+        }
+    }
+
+    const Material &GetMaterial(uint32_t id) const {
+        return materials[id];
+    }
+
+    Counters GetCounters() {
+        Counters total;
+        for (Shard &shard: shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total.hits += shard.counters.hits;
+            total.misses += shard.counters.misses;
+            total.evictions += shard.counters.evictions;
+            total.bytesPaged += shard.counters.bytesPaged;
+        }
+        return total;
+    }
+
+    bool IsOpen() const { return file.IsOpen(); }
+
+    int TriangleCount() const { return header.triangleCount; }
+
+private:
+    struct CacheEntry {
+        std::shared_ptr<const TriangleBlock> block;
+        std::list<uint32_t>::iterator position;
+    };
+
+    // 缓存的一片，容量为总容量按片均分
+    struct Shard {
+        size_t capacity = 0;
+        std::list<uint32_t> lru;    // 最近使用的块在前
+        std::unordered_map<uint32_t, CacheEntry> cache;
+        Counters counters;
+        std::mutex mutex;
+    };
+
+    MappedFile file;
+    GeometryStreamHeader header{};
+    std::vector<Material> materials;
+    Shard shards[GEOMETRY_STREAM_SHARDS];
+};
+
+#endif //GEOMETRY_STREAM_H
@@ -0,0 +1,157 @@
+#ifndef HDR_CACHE_FILE_H
+#define HDR_CACHE_FILE_H
+
+#include "EnvMapFormat.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// HDR 重要性采样的磁盘缓存 (.rtenv)，与 HDR 同目录同名
+// 每种采样方式一个文件，文件头之后只有该方式的采样表 (RGB float)：
+// ENV_SAMPLING_CDF 为 width x height 的 hdrCache，ENV_SAMPLING_ALIAS 为 width x (height + 1) 的别名表
+// 以 HDR 文件内容的哈希为键，亮度权重或数据布局改变时提升版本号使旧缓存失效
+// 版本 2：亮度权重改为与着色器一致的 Rec. 709
+// 版本 3：每个文件只存放一种采样表
+#define HDR_CACHE_FILE_MAGIC    0x43455452  // "RTEC"
+#define HDR_CACHE_FILE_VERSION  3
+
+struct HdrCacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint32_t method;            // ENV_SAMPLING_CDF 或 ENV_SAMPLING_ALIAS
+    uint32_t reserved;
+    uint64_t tableOffset;
+};
+
+// method 对应的采样表的行数，别名表多一行边缘分布
+int GetHdrSamplingTableRows(int method, int height) {
+    return method == ENV_SAMPLING_ALIAS ? height + 1 : height;
+}
+
+// 文件内容的哈希：按 4 MB 分块并行计算 FNV-1a，再将各块的哈希依次以 FNV-1a 合并
+uint64_t HashFileContents(const unsigned char *data, size_t size) {
+    const uint64_t offsetBasis = 14695981039346656037ull;
+    const uint64_t prime = 1099511628211ull;
+    const size_t blockSize = 4 << 20;
+
+    int nBlocks = (int) ((size + blockSize - 1) / blockSize);
+    std::vector<uint64_t> blockHash(nBlocks);
+    ParallelFor(0, nBlocks, 1, [&](int blockBegin, int blockEnd) {
+        for (int b = blockBegin; b < blockEnd; b++) {
+            const unsigned char *p = data + (size_t) b * blockSize;
+            const unsigned char *end = data + std::min(size, (size_t) (b + 1) * blockSize);
+            uint64_t h = offsetBasis;
+            for (; p < end; p++) h = (h ^ *p) * prime;
+            blockHash[b] = h;
+        }
+    });
+
+    uint64_t hash = offsetBasis;
+    for (uint64_t h: blockHash)
+        for (int k = 0; k < 8; k++) hash = (hash ^ ((h >> (8 * k)) & 0xff)) * prime;
+    return hash;
+}
+
+// 在键中混入影响采样分布的导入参数
+uint64_t MixHdrCacheKey(uint64_t key, float parameter) {
+    uint32_t bits;
+    std::memcpy(&bits, &parameter, 4);
+    const uint64_t prime = 1099511628211ull;
+    for (int k = 0; k < 4; k++) key = (key ^ ((bits >> (8 * k)) & 0xff)) * prime;
+    return (key ^ 0x53) * prime;    // 'S'，与不分离太阳的键区分
+}
+
+// 磁盘缓存的路径：与 HDR 同目录同名，CDF 缓存的扩展名为 .rtenv，别名表为 .alias.rtenv
+std::string GetHdrCacheFilePath(const std::string &hdrPath, int method) {
+    const char *extension = method == ENV_SAMPLING_ALIAS ? ".alias.rtenv" : ".rtenv";
+    size_t dot = hdrPath.find_last_of('.');
+    size_t slash = hdrPath.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return hdrPath + extension;
+    return hdrPath.substr(0, dot) + extension;
+}
+
+// 写入磁盘缓存，写入失败时删除不完整的文件
+bool WriteHdrCacheFile(const std::string &path, uint64_t sourceHash, uint64_t sourceSize, int width, int height,
+                       int method, const float *table) {
+    HdrCacheFileHeader header{};
+    header.magic = HDR_CACHE_FILE_MAGIC;
+    header.version = HDR_CACHE_FILE_VERSION;
+    header.width = width;
+    header.height = height;
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.method = method;
+    header.tableOffset = 64;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    char padding[64] = {0};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(padding, header.tableOffset - sizeof(header));
+    file.write(reinterpret_cast<const char *>(table),
+               (size_t) width * GetHdrSamplingTableRows(method, height) * 3 * sizeof(float));
+    file.close();
+
+    if (!file) {
+        std::remove(path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 内存映射的磁盘缓存，Table() 直接指向映射的内存，可直接作为 glTexImage2D 的数据
+class HdrCacheFile {
+public:
+    // 仅当文件完整、版本一致且采样方式、HDR 的哈希和大小都相符时成功
+    bool Open(const std::string &path, uint64_t sourceHash, uint64_t sourceSize, int width, int height, int method) {
+        header = nullptr;
+        if (!file.Open(path)) return false;
+
+        if (file.Size() < sizeof(HdrCacheFileHeader)) {
+            file.Close();
+            return false;
+        }
+        const auto *h = reinterpret_cast<const HdrCacheFileHeader *>(file.Data());
+        uint64_t tableBytes = (uint64_t) width * GetHdrSamplingTableRows(method, height) * 3 * sizeof(float);
+        if (h->magic != HDR_CACHE_FILE_MAGIC || h->version != HDR_CACHE_FILE_VERSION ||
+            h->sourceHash != sourceHash || h->sourceSize != sourceSize ||
+            h->width != (uint32_t) width || h->height != (uint32_t) height || h->method != (uint32_t) method ||
+            h->tableOffset > file.Size() || tableBytes > file.Size() - h->tableOffset) {
+            file.Close();
+            return false;
+        }
+        header = h;
+        return true;
+    }
+
+    void Close() {
+        file.Close();
+        header = nullptr;
+    }
+
+    bool IsOpen() const { return header != nullptr; }
+
+    int Method() const { return header ? (int) header->method : -1; }
+
+    const float *Table() const {
+        return header ? reinterpret_cast<const float *>(file.Data() + header->tableOffset) : nullptr;
+    }
+
+private:
+    MappedFile file;
+    const HdrCacheFileHeader *header = nullptr;
+};
+
+#endif //HDR_CACHE_FILE_H
@@ -0,0 +1,151 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+// 只读内存映射文件
+class MappedFile {
+public:
+    MappedFile() {}
+
+    ~MappedFile() { Close(); }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    MappedFile(MappedFile &&other) { *this = std::move(other); }
+
+    MappedFile &operator=(MappedFile &&other) {
+        if (this != &other) {
+            Close();
+            data = other.data;
+            size = other.size;
+            other.data = nullptr;
+            other.size = 0;
+#ifdef _WIN32
+            mapping = other.mapping;
+            other.mapping = nullptr;
+#endif
+        }
+        return *this;
+    }
+
+    bool Open(const std::string &path) {
+        Close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(file);
+        if (mapping == nullptr) return false;
+        data = (const unsigned char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (data == nullptr) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+            return false;
+        }
+        size = (size_t) fileSize.QuadPart;
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void *ptr = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (ptr == MAP_FAILED) return false;
+        data = (const unsigned char *) ptr;
+        size = (size_t) st.st_size;
+#endif
+        return true;
+    }
+
+    void Close() {
+        if (data == nullptr) return;
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle(mapping);
+        mapping = nullptr;
+#else
+        munmap((void *) data, size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    // 提示系统将按顺序访问整个文件，加大预读
+    void AdviseSequential() const {
+#ifndef _WIN32
+        if (data != nullptr) madvise((void *) data, size, MADV_SEQUENTIAL);
+#endif
+    }
+
+    // 通知系统丢弃 [offset, offset + bytes) 区间已读入的页，再次访问时重新从文件读取
+    void Evict(uint64_t offset, size_t bytes) const {
+#ifndef _WIN32
+        if (data == nullptr || offset >= size) return;
+        uint64_t pageSize = (uint64_t) sysconf(_SC_PAGESIZE);
+        uint64_t begin = offset / pageSize * pageSize;
+        uint64_t end = std::min<uint64_t>(offset + bytes, size);
+        madvise((void *) (data + begin), end - begin, MADV_DONTNEED);
+#endif
+    }
+
+    bool IsOpen() const { return data != nullptr; }
+
+    const unsigned char *Data() const { return data; }
+
+    size_t Size() const { return size; }
+
+private:
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE mapping = nullptr;
+#endif
+};
+
+// 文件修改时间，文件不存在时返回 -1
+int64_t GetFileModifiedTime(const std::string &path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return -1;
+    return (int64_t) st.st_mtime;
+}
+
+// 文件大小，文件不存在时返回 -1
+int64_t GetFileSize(const std::string &path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return -1;
+    return (int64_t) st.st_size;
+}
+
+#endif //MAPPED_FILE_H
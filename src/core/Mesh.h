@@ -8,7 +8,9 @@
 
 #include "Shader.h"
 
+#include <cstddef>
 #include <string>
+#include <utility>
 #include <vector>
 
 using namespace std;
@@ -26,6 +28,27 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// 网格数据的只读视图，不持有内存
+// 位置和法线可以是交错存储（Vertex 数组）或紧密排列的 vec3 数组
+struct MeshView {
+    const unsigned char *positions = nullptr;
+    const unsigned char *normals = nullptr;     // 可为空
+    size_t positionStride = sizeof(glm::vec3);
+    size_t normalStride = sizeof(glm::vec3);
+    const unsigned int *indices = nullptr;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+
+    const glm::vec3 &Position(size_t i) const {
+        return *reinterpret_cast<const glm::vec3 *>(positions + i * positionStride);
+    }
+
+    glm::vec3 Normal(size_t i) const {
+        if (normals == nullptr) return glm::vec3(0.0f);
+        return *reinterpret_cast<const glm::vec3 *>(normals + i * normalStride);
+    }
+};
+
 struct Texture {
     unsigned int id;
     string type;
@@ -38,20 +61,36 @@ public:
     vector<Vertex> vertices;
     vector<unsigned int> indices;
     vector<Texture> textures;
-    unsigned int VAO;
+    unsigned int VAO = 0;
 
     // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures) {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+    // setupGL 为 false 时只保留 CPU 端数据，不创建 VAO/VBO/EBO，无需 GL 上下文
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, bool setupGL = true) {
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        this->textures = std::move(textures);
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        if (setupGL) setupMesh();
+    }
+
+    // view of the vertex positions, normals and indices
+    MeshView View() const {
+        MeshView view;
+        const unsigned char *base = reinterpret_cast<const unsigned char *>(vertices.data());
+        view.positions = base + offsetof(Vertex, Position);
+        view.normals = base + offsetof(Vertex, Normal);
+        view.positionStride = view.normalStride = sizeof(Vertex);
+        view.indices = indices.data();
+        view.vertexCount = vertices.size();
+        view.indexCount = indices.size();
+        return view;
     }
 
     // render the mesh
     void Draw(Shader &shader) {
+        if (VAO == 0) return;
+
         // bind appropriate textures
         unsigned int diffuseNr = 1;
         unsigned int specularNr = 1;
@@ -88,7 +127,7 @@ public:
 
 private:
     // render data 
-    unsigned int VBO, EBO;
+    unsigned int VBO = 0, EBO = 0;
 
     // initializes all the buffer objects/arrays
     void setupMesh() {
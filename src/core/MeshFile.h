@@ -0,0 +1,263 @@
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include <glm/glm.hpp>
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "MeshReorder.h"
+#include "MeshStreamImport.h"
+#include "ObjLoader.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 二进制网格文件 (.rtmesh)
+// 文件头之后依次为 vertexCount 个位置 (vec3)、vertexCount 个法线 (vec3)、indexCount 个索引 (uint32)
+// 数据按小端序存储，偏移均相对文件起始位置
+// 版本 2：三角形和顶点按空间顺序重排
+#define MESH_FILE_MAGIC     0x424D5452  // "RTMB"
+#define MESH_FILE_VERSION   2
+
+// 不小于此大小的 OBJ 使用流式导入，内存受限；更小的文件使用更快的多线程加载器
+#define MESH_STREAM_IMPORT_BYTES (64ll << 20)
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint64_t positionsOffset;
+    uint64_t normalsOffset;
+    uint64_t indicesOffset;
+};
+
+// 写入二进制网格文件，normals 为空时写入零法线
+bool WriteMeshFile(const std::string &path, const std::vector<glm::vec3> &positions,
+                   const std::vector<glm::vec3> &normals, const std::vector<unsigned int> &indices) {
+    MeshFileHeader header{};
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.vertexCount = positions.size();
+    header.indexCount = indices.size();
+    header.positionsOffset = 64;
+    header.normalsOffset = header.positionsOffset + positions.size() * sizeof(glm::vec3);
+    header.indicesOffset = header.normalsOffset + positions.size() * sizeof(glm::vec3);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+
+    char padding[64] = {0};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(padding, header.positionsOffset - sizeof(header));
+    file.write(reinterpret_cast<const char *>(positions.data()), positions.size() * sizeof(glm::vec3));
+    if (normals.size() == positions.size()) {
+        file.write(reinterpret_cast<const char *>(normals.data()), normals.size() * sizeof(glm::vec3));
+    } else {
+        std::vector<glm::vec3> zero(positions.size(), glm::vec3(0.0f));
+        file.write(reinterpret_cast<const char *>(zero.data()), zero.size() * sizeof(glm::vec3));
+    }
+    file.write(reinterpret_cast<const char *>(indices.data()), indices.size() * sizeof(unsigned int));
+    file.close();
+
+    if (!file) {
+        std::remove(path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 转换完成后输出网格规模与峰值常驻内存
+void printMeshConverted(const std::string &srcPath, const std::string &dstPath, size_t nVertices, size_t nTriangles) {
+    double peakMB = GetPeakResidentBytes() / 1048576.0;
+    std::cout << "Mesh converted: " << srcPath << " -> " << dstPath << " (" << nVertices << " vertices, " << nTriangles
+              << " triangles), peak RSS " << peakMB << " MB";
+    if (nTriangles > 0) std::cout << " (" << peakMB / (nTriangles / 1e6) << " MB per million triangles)";
+    std::cout << std::endl;
+}
+
+// 读取源文件并写为二进制网格文件，多个网格合并为一个，写入前按空间顺序重排
+// PLY 和大 OBJ 流式导入；其余 OBJ 使用多线程加载器，其它格式使用 Assimp
+// 流式导入不支持的文件（如 PLY 的属性布局）依次退回多线程加载器和 Assimp
+bool ConvertToMeshFile(const std::string &srcPath, const std::string &dstPath) {
+    if (IsPlyFile(srcPath) || (IsObjFile(srcPath) && GetFileSize(srcPath) >= MESH_STREAM_IMPORT_BYTES)) {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<unsigned int> indices;
+        if (StreamImportMesh(srcPath, positions, normals, indices)) {
+            ReorderMeshSpatially(positions, normals, indices);
+            if (!WriteMeshFile(dstPath, positions, normals, indices)) {
+                std::cout << "ERROR::MESH_FILE::WRITE_FAILED " << dstPath << std::endl;
+                return false;
+            }
+            printMeshConverted(srcPath, dstPath, positions.size(), indices.size() / 3);
+            return true;
+        }
+        std::cout << "Mesh stream import failed, falling back to the full importer: " << srcPath << std::endl;
+    }
+
+    if (IsObjFile(srcPath)) {
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        if (LoadObj(srcPath, vertices, indices)) {
+            std::vector<glm::vec3> positions(vertices.size());
+            std::vector<glm::vec3> normals(vertices.size());
+            for (size_t i = 0; i < vertices.size(); i++) {
+                positions[i] = vertices[i].Position;
+                normals[i] = vertices[i].Normal;
+            }
+            ReorderMeshSpatially(positions, normals, indices);
+            if (!WriteMeshFile(dstPath, positions, normals, indices)) {
+                std::cout << "ERROR::MESH_FILE::WRITE_FAILED " << dstPath << std::endl;
+                return false;
+            }
+            printMeshConverted(srcPath, dstPath, positions.size(), indices.size() / 3);
+            return true;
+        }
+    }
+
+    Assimp::Importer importer;
+    const aiScene *scene = importer.ReadFile(srcPath, aiProcess_Triangulate | aiProcess_GenSmoothNormals);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+        return false;
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<unsigned int> indices;
+    for (unsigned int m = 0; m < scene->mNumMeshes; m++) {
+        const aiMesh *mesh = scene->mMeshes[m];
+        unsigned int base = positions.size();
+        for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+            positions.push_back(glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z));
+            if (mesh->HasNormals())
+                normals.push_back(glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z));
+            else
+                normals.push_back(glm::vec3(0.0f));
+        }
+        for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+            const aiFace &face = mesh->mFaces[i];
+            if (face.mNumIndices != 3) continue;    // 跳过点和线
+            for (unsigned int j = 0; j < 3; j++) indices.push_back(base + face.mIndices[j]);
+        }
+    }
+
+    ReorderMeshSpatially(positions, normals, indices);
+    if (!WriteMeshFile(dstPath, positions, normals, indices)) {
+        std::cout << "ERROR::MESH_FILE::WRITE_FAILED " << dstPath << std::endl;
+        return false;
+    }
+    printMeshConverted(srcPath, dstPath, positions.size(), indices.size() / 3);
+    return true;
+}
+
+// 数据段 [offset, offset + bytes) 是否位于文件头之后、文件之内，且按 4 字节对齐（float 与 uint32）
+// 先比较 offset 再用减法比较长度，避免 offset + bytes 溢出
+bool IsMeshFileRangeValid(uint64_t offset, uint64_t bytes, uint64_t fileSize) {
+    return offset % 4 == 0 && offset >= sizeof(MeshFileHeader) && offset <= fileSize && bytes <= fileSize - offset;
+}
+
+// 所有索引是否都小于 vertexCount，分块并行检查
+bool AreMeshIndicesValid(const unsigned int *indices, uint32_t indexCount, uint32_t vertexCount) {
+    std::atomic<bool> valid(true);
+    ParallelFor(0, (int) indexCount, 1 << 16, [&](int begin, int end) {
+        unsigned int maxIndex = 0;
+        for (int i = begin; i < end; i++) maxIndex = std::max(maxIndex, indices[i]);
+        if (maxIndex >= vertexCount) valid = false;
+    });
+    return valid;
+}
+
+// 内存映射的二进制网格，View() 直接指向映射的内存，不做解析和拷贝
+// 打开时检查一次文件头与索引，之后的读取不再做越界检查
+class MeshFile {
+public:
+    bool Open(const std::string &path) {
+        header = nullptr;
+        if (!file.Open(path)) return false;
+
+        if (file.Size() < sizeof(MeshFileHeader)) {
+            file.Close();
+            return false;
+        }
+        const auto *h = reinterpret_cast<const MeshFileHeader *>(file.Data());
+        if (h->magic != MESH_FILE_MAGIC || h->version != MESH_FILE_VERSION) {
+            file.Close();
+            return false;
+        }
+
+        uint64_t vertexBytes = (uint64_t) h->vertexCount * sizeof(glm::vec3);
+        uint64_t indexBytes = (uint64_t) h->indexCount * sizeof(unsigned int);
+        if (h->indexCount % 3 != 0 || h->indexCount > (uint32_t) INT_MAX ||
+            !IsMeshFileRangeValid(h->positionsOffset, vertexBytes, file.Size()) ||
+            !IsMeshFileRangeValid(h->normalsOffset, vertexBytes, file.Size()) ||
+            !IsMeshFileRangeValid(h->indicesOffset, indexBytes, file.Size()) ||
+            !AreMeshIndicesValid(reinterpret_cast<const unsigned int *>(file.Data() + h->indicesOffset),
+                                 h->indexCount, h->vertexCount)) {
+            std::cout << "ERROR::MESH_FILE::INVALID " << path << std::endl;
+            file.Close();
+            return false;
+        }
+        header = h;
+        return true;
+    }
+
+    MeshView View() const {
+        MeshView view;
+        if (header == nullptr) return view;
+        view.positions = file.Data() + header->positionsOffset;
+        view.normals = file.Data() + header->normalsOffset;
+        view.indices = reinterpret_cast<const unsigned int *>(file.Data() + header->indicesOffset);
+        view.vertexCount = header->vertexCount;
+        view.indexCount = header->indexCount;
+        return view;
+    }
+
+    std::vector<MeshView> Views() const {
+        return std::vector<MeshView>(1, View());
+    }
+
+private:
+    MappedFile file;
+    const MeshFileHeader *header = nullptr;
+};
+
+// 二进制网格的缓存路径：与源文件同目录同名，扩展名为 .rtmesh
+std::string GetMeshFilePath(const std::string &srcPath) {
+    size_t dot = srcPath.find_last_of('.');
+    size_t slash = srcPath.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return srcPath + ".rtmesh";
+    return srcPath.substr(0, dot) + ".rtmesh";
+}
+
+// 映射 srcPath 对应的二进制网格，缓存不存在、比源文件旧或版本不符时先重新转换
+bool LoadMeshFile(const std::string &srcPath, MeshFile &mesh) {
+    std::string meshPath = GetMeshFilePath(srcPath);
+    int64_t srcTime = GetFileModifiedTime(srcPath);
+    int64_t meshTime = GetFileModifiedTime(meshPath);
+
+    bool upToDate = meshTime >= 0 && meshTime >= srcTime;
+    if (upToDate && mesh.Open(meshPath)) return true;
+
+    if (srcTime < 0) {
+        std::cout << "ERROR::MESH_FILE::NOT_FOUND " << srcPath << std::endl;
+        return false;
+    }
+    if (!ConvertToMeshFile(srcPath, meshPath)) return false;
+    return mesh.Open(meshPath);
+}
+
+#endif //MESH_FILE_H
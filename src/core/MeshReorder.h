@@ -0,0 +1,91 @@
+#ifndef MESH_REORDER_H
+#define MESH_REORDER_H
+
+#include <glm/glm.hpp>
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// 网格的空间重排
+// 三角形按重心的 Morton 码（Z 序曲线）排序，顶点按排序后首次被引用的顺序重新编号
+// 空间上相邻的三角形和顶点在数组中也相邻：getTriangle 按索引读取顶点时近似顺序访问，
+// BVH 构建的排序输入已接近有序，叶子内三角形来自同一段连续内存
+
+// 将 21 位整数的各位间隔两位展开
+uint64_t ExpandBits21(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffull;
+    v = (v | v << 16) & 0x1f0000ff0000ffull;
+    v = (v | v << 8) & 0x100f00f00f00f00full;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ull;
+    v = (v | v << 2) & 0x1249249249249249ull;
+    return v;
+}
+
+// [0, 1]^3 内一点的 63 位 Morton 码
+uint64_t MortonCode3D(const glm::vec3 &p) {
+    const float scale = (float) ((1 << 21) - 1);
+    glm::vec3 q = glm::clamp(p, glm::vec3(0.0f), glm::vec3(1.0f)) * scale;
+    return ExpandBits21((uint64_t) q.x) << 2 | ExpandBits21((uint64_t) q.y) << 1 | ExpandBits21((uint64_t) q.z);
+}
+
+// 按 remap 重排顶点数组，remap 为 UINT32_MAX 的顶点被丢弃
+void permuteVertices(std::vector<glm::vec3> &data, const std::vector<unsigned int> &remap, unsigned int count) {
+    std::vector<glm::vec3> permuted(count);
+    for (size_t i = 0; i < remap.size(); i++)
+        if (remap[i] != UINT32_MAX) permuted[remap[i]] = data[i];
+    data.swap(permuted);
+}
+
+// 原地重排网格，未被引用的顶点被移除；normals 为空时只重排位置
+void ReorderMeshSpatially(std::vector<glm::vec3> &positions, std::vector<glm::vec3> &normals,
+                          std::vector<unsigned int> &indices) {
+    size_t nTriangles = indices.size() / 3;
+    if (nTriangles == 0) return;
+
+    glm::vec3 lo(1e30f), hi(-1e30f);
+    for (const glm::vec3 &p: positions) {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    glm::vec3 len = hi - lo;
+    float maxaxis = glm::max(len.x, glm::max(len.y, len.z));
+    float inv = maxaxis > 0 ? 1.0f / maxaxis : 0.0f;
+
+    // (Morton 码, 三角形序号)，序号参与比较使结果确定
+    std::vector<std::pair<uint64_t, uint32_t>> keys(nTriangles);
+    ParallelFor(0, (int) nTriangles, 1 << 14, [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            const unsigned int *t = &indices[3 * i];
+            glm::vec3 center = (positions[t[0]] + positions[t[1]] + positions[t[2]]) / 3.0f;
+            keys[i] = std::make_pair(MortonCode3D((center - lo) * inv), (uint32_t) i);
+        }
+    });
+    std::sort(keys.begin(), keys.end());
+
+    // 按新的三角形顺序重写索引，顶点按首次引用编号
+    std::vector<unsigned int> remap(positions.size(), UINT32_MAX);
+    std::vector<unsigned int> newIndices(nTriangles * 3);
+    unsigned int nVertices = 0;
+    for (size_t i = 0; i < nTriangles; i++) {
+        const unsigned int *t = &indices[3 * keys[i].second];
+        for (int j = 0; j < 3; j++) {
+            unsigned int &index = remap[t[j]];
+            if (index == UINT32_MAX) index = nVertices++;
+            newIndices[3 * i + j] = index;
+        }
+    }
+    // 旧数组用完即释放，降低导入大网格时的峰值内存
+    std::vector<std::pair<uint64_t, uint32_t>>().swap(keys);
+    indices.swap(newIndices);
+    std::vector<unsigned int>().swap(newIndices);
+
+    permuteVertices(positions, remap, nVertices);
+    if (normals.size() == remap.size()) permuteVertices(normals, remap, nVertices);
+}
+
+#endif //MESH_REORDER_H
@@ -0,0 +1,459 @@
+/*
+ * MeshSimplifier 的边折叠部分（阈值迭代、引用区间压缩、翻转检测）移植自
+ * Fast-Quadric-Mesh-Simplification: https://github.com/sp4cerat/Fast-Quadric-Mesh-Simplification
+ *
+ * MIT License
+ *
+ * Copyright (c) 2014 Sven Forstmann
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MESH_SIMPLIFY_H
+#define MESH_SIMPLIFY_H
+
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "MeshReorder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// 网格简化与 LOD
+// 二次误差度量 (Garland & Heckbert 1997) 的边折叠：每个顶点累积相邻三角形平面的二次型，
+// 折叠边 (v0, v1) 时新顶点取使 Q0 + Q1 误差最小的位置
+// 不用优先队列，而是逐轮提高误差阈值，折叠所有低于阈值的边，每轮为线性时间
+// 开放边界上的边不折叠，以保持网格轮廓；会使三角形翻转的折叠被拒绝
+// 简化算法移植自 Fast-Quadric-Mesh-Simplification（MIT），版权声明见文件开头
+
+// 每级 LOD 保留上一级三角形数的比例
+#define MESH_LOD_RATIO 0.25f
+
+// 简化后的网格，持有位置、平滑法线和索引
+struct MeshLOD {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<unsigned int> indices;
+
+    size_t TriangleCount() const { return indices.size() / 3; }
+
+    MeshView View() const {
+        MeshView view;
+        view.positions = reinterpret_cast<const unsigned char *>(positions.data());
+        view.normals = reinterpret_cast<const unsigned char *>(normals.data());
+        view.indices = indices.data();
+        view.vertexCount = positions.size();
+        view.indexCount = indices.size();
+        return view;
+    }
+};
+
+// 对称 4x4 矩阵，按上三角存储 10 个元素
+struct QuadricMatrix {
+    double m[10];
+
+    QuadricMatrix() { std::memset(m, 0, sizeof(m)); }
+
+    // 平面 ax + by + cz + d = 0 的二次型
+    QuadricMatrix(double a, double b, double c, double d) {
+        m[0] = a * a; m[1] = a * b; m[2] = a * c; m[3] = a * d;
+        m[4] = b * b; m[5] = b * c; m[6] = b * d;
+        m[7] = c * c; m[8] = c * d;
+        m[9] = d * d;
+    }
+
+    QuadricMatrix operator+(const QuadricMatrix &q) const {
+        QuadricMatrix r;
+        for (int i = 0; i < 10; i++) r.m[i] = m[i] + q.m[i];
+        return r;
+    }
+
+    double Det(int a11, int a12, int a13, int a21, int a22, int a23, int a31, int a32, int a33) const {
+        return m[a11] * m[a22] * m[a33] + m[a13] * m[a21] * m[a32] + m[a12] * m[a23] * m[a31]
+               - m[a13] * m[a22] * m[a31] - m[a11] * m[a23] * m[a32] - m[a12] * m[a21] * m[a33];
+    }
+
+    // v^T Q v，v = (x, y, z, 1)
+    double Error(const glm::vec3 &v) const {
+        double x = v.x, y = v.y, z = v.z;
+        return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x
+               + m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y
+               + m[7] * z * z + 2 * m[8] * z + m[9];
+    }
+};
+
+class MeshSimplifier {
+public:
+    // 按位置焊接顶点后载入网格
+    // OBJ 导入在 UV / 法线接缝处拆分了顶点，不焊接的话接缝会被当作开放边界而无法简化
+    // 坐标平移缩放到单位包围盒内，误差阈值与模型尺寸无关
+    void Load(const MeshView &view) {
+        vertices.clear();
+        triangles.clear();
+
+        glm::vec3 lo(1e30f), hi(-1e30f);
+        for (size_t i = 0; i < view.vertexCount; i++) {
+            lo = glm::min(lo, view.Position(i));
+            hi = glm::max(hi, view.Position(i));
+        }
+        glm::vec3 len = hi - lo;
+        float maxaxis = std::max(len.x, std::max(len.y, len.z));
+        origin = lo;
+        extent = maxaxis > 0 ? maxaxis : 1.0f;
+
+        std::unordered_map<PositionKey, int, PositionKeyHash> welded;
+        welded.reserve(view.vertexCount);
+        std::vector<int> remap(view.vertexCount);
+        for (size_t i = 0; i < view.vertexCount; i++) {
+            const glm::vec3 &p = view.Position(i);
+            PositionKey key;
+            std::memcpy(key.bits, &p, sizeof(key.bits));
+            auto it = welded.find(key);
+            if (it == welded.end()) {
+                it = welded.emplace(key, (int) vertices.size()).first;
+                Vertex v;
+                v.p = (p - origin) / extent;
+                vertices.push_back(v);
+            }
+            remap[i] = it->second;
+        }
+
+        triangles.reserve(view.indexCount / 3);
+        for (size_t i = 0; i + 2 < view.indexCount; i += 3) {
+            Face t;
+            t.v[0] = remap[view.indices[i]];
+            t.v[1] = remap[view.indices[i + 1]];
+            t.v[2] = remap[view.indices[i + 2]];
+            if (t.v[0] == t.v[1] || t.v[1] == t.v[2] || t.v[0] == t.v[2]) continue;   // 焊接后退化
+            triangles.push_back(t);
+        }
+    }
+
+    // 折叠边直到三角形数不超过 target，或任何折叠的误差都超过阈值上限
+    void Simplify(size_t target, double aggressiveness = 7.0) {
+        size_t deletedTriangles = 0;
+        std::vector<int> deleted0, deleted1;
+        size_t count = triangles.size();
+
+        for (int iteration = 0; iteration < 100; iteration++) {
+            if (count - deletedTriangles <= target) break;
+
+            // 每隔几轮压缩三角形数组并重建邻接表
+            if (iteration % 5 == 0) {
+                updateMesh(iteration);
+                count = triangles.size();
+                deletedTriangles = 0;
+            }
+
+            for (auto &t: triangles) t.dirty = false;
+
+            // 阈值随轮数增长，先折叠误差最小的边
+            double threshold = 1e-9 * std::pow(double(iteration + 3), aggressiveness);
+
+            for (size_t i = 0; i < triangles.size(); i++) {
+                Face &t = triangles[i];
+                if (t.err[3] > threshold || t.deleted || t.dirty) continue;
+
+                for (int j = 0; j < 3; j++) {
+                    if (t.err[j] > threshold) continue;
+                    int i0 = t.v[j];
+                    int i1 = t.v[(j + 1) % 3];
+                    Vertex &v0 = vertices[i0];
+                    Vertex &v1 = vertices[i1];
+                    if (v0.border || v1.border) continue;
+
+                    glm::vec3 p;
+                    collapseError(i0, i1, p);
+                    deleted0.assign(v0.tcount, 0);
+                    deleted1.assign(v1.tcount, 0);
+                    if (flipped(p, i1, v0, deleted0)) continue;
+                    if (flipped(p, i0, v1, deleted1)) continue;
+
+                    v0.p = p;
+                    v0.q = v1.q + v0.q;
+                    int tstart = refs.size();
+                    updateTriangles(i0, v0, deleted0, deletedTriangles);
+                    updateTriangles(i0, v1, deleted1, deletedTriangles);
+                    int tcount = refs.size() - tstart;
+                    if (tcount <= v0.tcount) {
+                        // 复用 v0 原来的引用区间
+                        if (tcount) std::copy(refs.begin() + tstart, refs.begin() + tstart + tcount, refs.begin() + v0.tstart);
+                        refs.resize(tstart);
+                    } else {
+                        v0.tstart = tstart;
+                    }
+                    v0.tcount = tcount;
+                    break;
+                }
+                if (count - deletedTriangles <= target) break;
+            }
+        }
+    }
+
+    // 输出剩余的三角形，坐标还原到原空间，并按面积加权重新生成平滑法线
+    void Store(MeshLOD &lod) const {
+        std::vector<int> remap(vertices.size(), -1);
+        lod.positions.clear();
+        lod.indices.clear();
+        for (const Face &t: triangles) {
+            if (t.deleted) continue;
+            for (int j = 0; j < 3; j++) {
+                int &index = remap[t.v[j]];
+                if (index < 0) {
+                    index = lod.positions.size();
+                    lod.positions.push_back(vertices[t.v[j]].p * extent + origin);
+                }
+                lod.indices.push_back(index);
+            }
+        }
+
+        lod.normals.assign(lod.positions.size(), glm::vec3(0));
+        for (size_t i = 0; i < lod.indices.size(); i += 3) {
+            const glm::vec3 &p0 = lod.positions[lod.indices[i]];
+            const glm::vec3 &p1 = lod.positions[lod.indices[i + 1]];
+            const glm::vec3 &p2 = lod.positions[lod.indices[i + 2]];
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            for (int j = 0; j < 3; j++) lod.normals[lod.indices[i + j]] += n;
+        }
+        for (auto &n: lod.normals) {
+            float l = glm::length(n);
+            n = l > 0 ? n / l : glm::vec3(0, 1, 0);
+        }
+    }
+
+private:
+    struct Vertex {
+        glm::vec3 p;
+        QuadricMatrix q;
+        int tstart = 0;
+        int tcount = 0;
+        bool border = false;
+    };
+
+    struct Face {
+        int v[3];
+        double err[4];      // 三条边的折叠误差及其最小值
+        glm::vec3 n;
+        bool deleted = false;
+        bool dirty = false;
+    };
+
+    // 顶点到所在三角形的引用
+    struct Ref {
+        int tid;
+        int tvertex;
+    };
+
+    struct PositionKey {
+        uint32_t bits[3];
+
+        bool operator==(const PositionKey &k) const {
+            return bits[0] == k.bits[0] && bits[1] == k.bits[1] && bits[2] == k.bits[2];
+        }
+    };
+
+    struct PositionKeyHash {
+        size_t operator()(const PositionKey &k) const {
+            uint64_t h = 1469598103934665603ull;
+            for (uint32_t b: k.bits) h = (h ^ b) * 1099511628211ull;
+            return (size_t) h;
+        }
+    };
+
+    std::vector<Vertex> vertices;
+    std::vector<Face> triangles;
+    std::vector<Ref> refs;
+    glm::vec3 origin = glm::vec3(0);
+    float extent = 1;
+
+    // 折叠 (i0, i1) 的误差及新顶点位置
+    double collapseError(int i0, int i1, glm::vec3 &result) const {
+        QuadricMatrix q = vertices[i0].q + vertices[i1].q;
+        double det = q.Det(0, 1, 2, 1, 4, 5, 2, 5, 7);
+        if (det != 0) {
+            // 二次型可逆：取误差最小的点
+            result.x = float(-1 / det * q.Det(1, 2, 3, 4, 5, 6, 5, 7, 8));
+            result.y = float(1 / det * q.Det(0, 2, 3, 1, 5, 6, 2, 7, 8));
+            result.z = float(-1 / det * q.Det(0, 1, 3, 1, 4, 6, 2, 5, 8));
+            return q.Error(result);
+        }
+        // 不可逆时在两个端点和中点中选择
+        const glm::vec3 &p1 = vertices[i0].p;
+        const glm::vec3 &p2 = vertices[i1].p;
+        glm::vec3 p3 = (p1 + p2) * 0.5f;
+        double e1 = q.Error(p1), e2 = q.Error(p2), e3 = q.Error(p3);
+        double error = std::min(e1, std::min(e2, e3));
+        if (error == e1) result = p1;
+        else if (error == e2) result = p2;
+        else result = p3;
+        return error;
+    }
+
+    // v 移动到 p 后其相邻三角形是否翻转或退化，同时包含 i1 的三角形记入 deleted
+    bool flipped(const glm::vec3 &p, int i1, const Vertex &v, std::vector<int> &deleted) const {
+        for (int k = 0; k < v.tcount; k++) {
+            const Ref &r = refs[v.tstart + k];
+            const Face &t = triangles[r.tid];
+            if (t.deleted) continue;
+
+            int id1 = t.v[(r.tvertex + 1) % 3];
+            int id2 = t.v[(r.tvertex + 2) % 3];
+            if (id1 == i1 || id2 == i1) {
+                deleted[k] = 1;
+                continue;
+            }
+            glm::vec3 d1 = vertices[id1].p - p;
+            glm::vec3 d2 = vertices[id2].p - p;
+            float l1 = glm::length(d1), l2 = glm::length(d2);
+            if (l1 == 0 || l2 == 0) return true;
+            d1 /= l1;
+            d2 /= l2;
+            if (std::fabs(glm::dot(d1, d2)) > 0.999f) return true;
+            glm::vec3 n = glm::normalize(glm::cross(d1, d2));
+            deleted[k] = 0;
+            if (glm::dot(n, t.n) < 0.2f) return true;
+        }
+        return false;
+    }
+
+    // 折叠后把 v 的三角形改为引用 i0，删除退化的三角形
+    void updateTriangles(int i0, const Vertex &v, const std::vector<int> &deleted, size_t &deletedTriangles) {
+        glm::vec3 p;
+        for (int k = 0; k < v.tcount; k++) {
+            Ref r = refs[v.tstart + k];
+            Face &t = triangles[r.tid];
+            if (t.deleted) continue;
+            if (deleted[k]) {
+                t.deleted = true;
+                deletedTriangles++;
+                continue;
+            }
+            t.v[r.tvertex] = i0;
+            t.dirty = true;
+            t.err[0] = collapseError(t.v[0], t.v[1], p);
+            t.err[1] = collapseError(t.v[1], t.v[2], p);
+            t.err[2] = collapseError(t.v[2], t.v[0], p);
+            t.err[3] = std::min(t.err[0], std::min(t.err[1], t.err[2]));
+            refs.push_back(r);
+        }
+    }
+
+    // 压缩三角形数组、重建顶点到三角形的引用；首轮同时标记边界并计算二次型
+    void updateMesh(int iteration) {
+        if (iteration > 0) {
+            size_t dst = 0;
+            for (size_t i = 0; i < triangles.size(); i++)
+                if (!triangles[i].deleted) triangles[dst++] = triangles[i];
+            triangles.resize(dst);
+        }
+
+        for (auto &v: vertices) {
+            v.tstart = 0;
+            v.tcount = 0;
+        }
+        for (auto &t: triangles)
+            for (int j = 0; j < 3; j++) vertices[t.v[j]].tcount++;
+        int tstart = 0;
+        for (auto &v: vertices) {
+            v.tstart = tstart;
+            tstart += v.tcount;
+            v.tcount = 0;
+        }
+        refs.resize(triangles.size() * 3);
+        for (size_t i = 0; i < triangles.size(); i++) {
+            for (int j = 0; j < 3; j++) {
+                Vertex &v = vertices[triangles[i].v[j]];
+                refs[v.tstart + v.tcount] = Ref{(int) i, j};
+                v.tcount++;
+            }
+        }
+
+        if (iteration != 0) return;
+
+        // 边界：只被一个三角形使用的边
+        std::vector<int> vcount, vids;
+        for (auto &v: vertices) v.border = false;
+        for (auto &v: vertices) {
+            vcount.clear();
+            vids.clear();
+            for (int k = 0; k < v.tcount; k++) {
+                const Face &t = triangles[refs[v.tstart + k].tid];
+                for (int j = 0; j < 3; j++) {
+                    int id = t.v[j];
+                    size_t ofs = 0;
+                    while (ofs < vcount.size() && vids[ofs] != id) ofs++;
+                    if (ofs == vcount.size()) {
+                        vcount.push_back(1);
+                        vids.push_back(id);
+                    } else {
+                        vcount[ofs]++;
+                    }
+                }
+            }
+            for (size_t j = 0; j < vcount.size(); j++)
+                if (vcount[j] == 1) vertices[vids[j]].border = true;
+        }
+
+        for (auto &v: vertices) v.q = QuadricMatrix();
+        for (auto &t: triangles) {
+            const glm::vec3 &p0 = vertices[t.v[0]].p;
+            glm::vec3 n = glm::cross(vertices[t.v[1]].p - p0, vertices[t.v[2]].p - p0);
+            float l = glm::length(n);
+            t.n = l > 0 ? n / l : glm::vec3(0);
+            QuadricMatrix q(t.n.x, t.n.y, t.n.z, -glm::dot(t.n, p0));
+            for (int j = 0; j < 3; j++) vertices[t.v[j]].q = vertices[t.v[j]].q + q;
+        }
+        glm::vec3 p;
+        for (auto &t: triangles) {
+            t.err[0] = collapseError(t.v[0], t.v[1], p);
+            t.err[1] = collapseError(t.v[1], t.v[2], p);
+            t.err[2] = collapseError(t.v[2], t.v[0], p);
+            t.err[3] = std::min(t.err[0], std::min(t.err[1], t.err[2]));
+        }
+    }
+};
+
+// 将 view 简化到约 target 个三角形，结果按空间顺序重排
+void SimplifyMesh(const MeshView &view, size_t target, MeshLOD &lod) {
+    MeshSimplifier simplifier;
+    simplifier.Load(view);
+    simplifier.Simplify(target);
+    simplifier.Store(lod);
+    ReorderMeshSpatially(lod.positions, lod.normals, lod.indices);
+}
+
+// 物体包围球在屏幕上投影的直径（像素）
+// lo / hi 为网格的 AABB，model 为网格到世界空间的变换，halfH 为相机半视角的正切
+float GetProjectedDiameter(const glm::vec3 &lo, const glm::vec3 &hi, const glm::mat4 &model,
+                           const glm::vec3 &eye, float halfH, float screenHeight) {
+    glm::vec3 center = glm::vec3(model * glm::vec4((lo + hi) * 0.5f, 1.0f));
+    float scale = std::max(glm::length(glm::vec3(model[0])),
+                           std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    float radius = 0.5f * glm::length(hi - lo) * scale;
+    float distance = glm::length(center - eye);
+    if (distance <= radius) return 1e30f;   // 相机在包围球内
+    return radius / (distance * halfH) * screenHeight;
+}
+
+#endif //MESH_SIMPLIFY_H
@@ -0,0 +1,576 @@
+#ifndef MESH_STREAM_IMPORT_H
+#define MESH_STREAM_IMPORT_H
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include "ObjLoader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 流式网格导入 (OBJ / PLY)
+// 文件以固定大小的块读入同一个缓冲区，边读边解析，直接追加到输出的位置、法线、索引数组
+// 不保留整个文件、不建立中间场景，峰值内存约为输出数组本身的大小
+
+// 读取缓冲区大小
+#define MESH_IMPORT_CHUNK_BYTES (4 << 20)
+
+// 进程的峰值常驻内存 (字节)，不支持的平台返回 0
+uint64_t GetPeakResidentBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return (uint64_t) counters.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (uint64_t) usage.ru_maxrss;          // 字节
+#else
+    return (uint64_t) usage.ru_maxrss * 1024;   // KB
+#endif
+#endif
+}
+
+// 按固定大小的块读取文件，支持按行读取（文本）和按字节读取（二进制）
+class ChunkedFileReader {
+public:
+    ~ChunkedFileReader() { Close(); }
+
+    bool Open(const std::string &path) {
+        Close();
+        file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) return false;
+        this->path = path;
+        buffer.resize(MESH_IMPORT_CHUNK_BYTES);
+        pos = size = 0;
+        eof = false;
+        failed = false;
+        return true;
+    }
+
+    void Close() {
+        if (file != nullptr) std::fclose(file);
+        file = nullptr;
+    }
+
+    // 读取一行，[begin, end) 不含换行符
+    // 行长超过缓冲区时输出错误并返回 false，之后 Failed() 为 true，调用方据此区分文件结束
+    bool Line(const char *&begin, const char *&end) {
+        if (failed) return false;
+        while (true) {
+            const char *first = buffer.data() + pos;
+            const char *newline = (const char *) std::memchr(first, '\n', size - pos);
+            if (newline != nullptr) {
+                begin = first;
+                end = newline;
+                pos = newline - buffer.data() + 1;
+                return true;
+            }
+            if (pos == 0 && size == buffer.size()) {
+                std::cout << "ERROR::MESH_IMPORT::LINE_TOO_LONG " << path << " (over " << buffer.size() << " bytes)"
+                          << std::endl;
+                failed = true;
+                return false;
+            }
+            if (eof) {
+                // 文件末尾没有换行的最后一行
+                if (pos == size) return false;
+                begin = first;
+                end = buffer.data() + size;
+                pos = size;
+                return true;
+            }
+            fill();
+        }
+    }
+
+    bool Read(void *dst, size_t bytes) {
+        char *out = (char *) dst;
+        while (bytes > 0) {
+            if (pos == size) {
+                if (eof) return false;
+                fill();
+                continue;
+            }
+            size_t n = std::min(bytes, size - pos);
+            std::memcpy(out, buffer.data() + pos, n);
+            pos += n;
+            out += n;
+            bytes -= n;
+        }
+        return true;
+    }
+
+    bool Failed() const { return failed; }
+
+private:
+    FILE *file = nullptr;
+    std::string path;
+    std::vector<char> buffer;
+    size_t pos = 0;
+    size_t size = 0;
+    bool eof = false;
+    bool failed = false;    // 遇到超长的行
+
+    // 未处理的数据移到缓冲区开头，读入下一块填满其余部分
+    void fill() {
+        size_t remaining = size - pos;
+        if (remaining > 0 && pos > 0) std::memmove(buffer.data(), buffer.data() + pos, remaining);
+        pos = 0;
+        size = remaining;
+        size_t n = std::fread(buffer.data() + size, 1, buffer.size() - size, file);
+        size += n;
+        if (n == 0) eof = true;
+    }
+};
+
+// 扩展名是否为 .ply（不区分大小写）
+bool IsPlyFile(const std::string &path) {
+    if (path.size() < 4) return false;
+    std::string ext = path.substr(path.size() - 4);
+    for (auto &c: ext) c = (char) tolower((unsigned char) c);
+    return ext == ".ply";
+}
+
+// 按面积加权生成平滑法线
+void ComputeSmoothNormals(const std::vector<glm::vec3> &positions, const std::vector<unsigned int> &indices,
+                          std::vector<glm::vec3> &normals) {
+    normals.assign(positions.size(), glm::vec3(0.0f));
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        const glm::vec3 &p1 = positions[indices[i]];
+        const glm::vec3 &p2 = positions[indices[i + 1]];
+        const glm::vec3 &p3 = positions[indices[i + 2]];
+        glm::vec3 n = glm::cross(p2 - p1, p3 - p1);
+        for (int k = 0; k < 3; k++) normals[indices[i + k]] += n;
+    }
+    for (auto &n: normals) {
+        float len = glm::length(n);
+        n = len > 0.0f ? n / len : glm::vec3(0.0f);
+    }
+}
+
+// OBJ
+// -----
+
+// 输出顶点默认与 OBJ 的位置一一对应，位置第一次被引用时记下所用法线
+// 同一位置以不同法线被引用（法线接缝）时才拆分出新顶点，只有拆分的顶点进入哈希表
+// 拆分顶点的索引在解析期间以最高位标记，解析结束后统一放到位置数组之后
+// 纹理坐标不写入 .rtmesh，因此不参与拆分；索引只能引用已出现的元素
+// 没有 vn 的引用按位置生成平滑法线，文件中的其它顶点仍使用文件给出的法线
+bool StreamObj(const std::string &path, std::vector<glm::vec3> &positions, std::vector<glm::vec3> &normals,
+               std::vector<unsigned int> &indices) {
+    const unsigned int SPLIT_BIT = 0x80000000u;
+    const int UNASSIGNED = INT_MIN + 1;
+
+    ChunkedFileReader reader;
+    if (!reader.Open(path)) {
+        std::cout << "ERROR::MESH_IMPORT::CANNOT_OPEN " << path << std::endl;
+        return false;
+    }
+
+    std::vector<glm::vec3> fileNormals;
+    std::vector<int> assignedNormal;            // 每个位置首次被引用时的法线，OBJ_NO_INDEX 表示无法线
+    std::vector<std::pair<int, int>> splits;    // 拆分顶点的 (位置, 法线)
+    std::unordered_map<uint64_t, unsigned int> splitIndex;
+    positions.clear();
+    indices.clear();
+
+    std::vector<unsigned int> face;
+    const char *p, *end;
+    bool valid = true;
+    while (valid && reader.Line(p, end)) {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+
+        if (end - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            p += 2;
+            glm::vec3 v;
+            for (int i = 0; i < 3; i++) {
+                while (p < end && (*p == ' ' || *p == '\t')) p++;
+                v[i] = ParseFloat(p, end);
+            }
+            positions.push_back(v);
+            assignedNormal.push_back(UNASSIGNED);
+        } else if (end - p >= 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+            p += 3;
+            glm::vec3 n;
+            for (int i = 0; i < 3; i++) {
+                while (p < end && (*p == ' ' || *p == '\t')) p++;
+                n[i] = ParseFloat(p, end);
+            }
+            fileNormals.push_back(n);
+        } else if (end - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            p += 2;
+            face.clear();
+            while (true) {
+                while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+                if (p >= end) break;
+
+                int v = ParseInt(p, end);
+                int vn = OBJ_NO_INDEX;
+                if (p < end && *p == '/') {
+                    p++;
+                    if (p < end && *p != '/') ParseInt(p, end);     // vt
+                    if (p < end && *p == '/') {
+                        p++;
+                        vn = ParseInt(p, end);
+                    }
+                }
+                while (p < end && *p != ' ' && *p != '\t' && *p != '\r') p++;
+
+                // 解析为 0 起始的下标
+                v = v > 0 ? v - 1 : (int) positions.size() + v;
+                if (vn != OBJ_NO_INDEX) vn = vn > 0 ? vn - 1 : (int) fileNormals.size() + vn;
+                if (v < 0 || v >= (int) positions.size() ||
+                    (vn != OBJ_NO_INDEX && (vn < 0 || vn >= (int) fileNormals.size()))) {
+                    valid = false;
+                    break;
+                }
+
+                unsigned int index = v;
+                if (assignedNormal[v] == UNASSIGNED) {
+                    assignedNormal[v] = vn;
+                } else if (assignedNormal[v] != vn) {
+                    uint64_t key = (uint64_t) (uint32_t) v << 32 | (uint32_t) vn;
+                    auto it = splitIndex.insert(std::make_pair(key, (unsigned int) splits.size()));
+                    if (it.second) splits.push_back(std::make_pair(v, vn));
+                    index = it.first->second | SPLIT_BIT;
+                }
+                face.push_back(index);
+            }
+
+            // 扇形三角化
+            for (size_t i = 2; valid && i < face.size(); i++) {
+                indices.push_back(face[0]);
+                indices.push_back(face[i - 1]);
+                indices.push_back(face[i]);
+            }
+        }
+    }
+    if (!valid) {
+        std::cout << "ERROR::MESH_IMPORT::INVALID_INDEX " << path << std::endl;
+        return false;
+    }
+    if (reader.Failed()) return false;
+    splitIndex.clear();
+
+    // 拆分顶点接在位置之后
+    unsigned int nPositions = positions.size();
+    for (auto &index: indices)
+        if (index & SPLIT_BIT) index = nPositions + (index & ~SPLIT_BIT);
+    positions.reserve(nPositions + splits.size());
+    for (auto &split: splits) {
+        positions.push_back(positions[split.first]);
+        assignedNormal.push_back(split.second);
+    }
+
+    if (fileNormals.empty()) {
+        ComputeSmoothNormals(positions, indices, normals);
+        return true;
+    }
+
+    normals.resize(positions.size());
+    bool missingNormals = false;
+    for (size_t i = 0; i < positions.size(); i++) {
+        normals[i] = assignedNormal[i] >= 0 ? fileNormals[assignedNormal[i]] : glm::vec3(0.0f);
+        missingNormals = missingNormals || assignedNormal[i] == OBJ_NO_INDEX;
+    }
+    if (missingNormals) {
+        // 面积加权法线按原位置累加，拆分顶点与其原位置共用同一个法线
+        std::vector<glm::vec3> accumulated(nPositions, glm::vec3(0.0f));
+        auto source = [&](unsigned int vertex) {
+            return vertex < nPositions ? vertex : (unsigned int) splits[vertex - nPositions].first;
+        };
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            const glm::vec3 &p1 = positions[indices[i]];
+            const glm::vec3 &p2 = positions[indices[i + 1]];
+            const glm::vec3 &p3 = positions[indices[i + 2]];
+            glm::vec3 n = glm::cross(p2 - p1, p3 - p1);
+            for (int k = 0; k < 3; k++) accumulated[source(indices[i + k])] += n;
+        }
+        for (size_t i = 0; i < positions.size(); i++) {
+            if (assignedNormal[i] != OBJ_NO_INDEX) continue;
+            glm::vec3 n = accumulated[source(i)];
+            float len = glm::length(n);
+            normals[i] = len > 0.0f ? n / len : glm::vec3(0.0f);
+        }
+    }
+    return true;
+}
+
+// PLY
+// -----
+
+enum PlyType {
+    PLY_NONE, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32, PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64
+};
+
+PlyType ParsePlyType(const std::string &name) {
+    if (name == "char" || name == "int8") return PLY_INT8;
+    if (name == "uchar" || name == "uint8") return PLY_UINT8;
+    if (name == "short" || name == "int16") return PLY_INT16;
+    if (name == "ushort" || name == "uint16") return PLY_UINT16;
+    if (name == "int" || name == "int32") return PLY_INT32;
+    if (name == "uint" || name == "uint32") return PLY_UINT32;
+    if (name == "float" || name == "float32") return PLY_FLOAT32;
+    if (name == "double" || name == "float64") return PLY_FLOAT64;
+    return PLY_NONE;
+}
+
+struct PlyProperty {
+    std::string name;
+    PlyType type = PLY_NONE;
+    PlyType countType = PLY_NONE;   // 非 PLY_NONE 时为列表属性
+};
+
+struct PlyElement {
+    std::string name;
+    uint64_t count = 0;
+    std::vector<PlyProperty> properties;
+};
+
+// 逐个读取 PLY 元素的属性值，ASCII 从当前行解析，二进制从文件读取
+class PlyValueReader {
+public:
+    PlyValueReader(ChunkedFileReader &reader, bool ascii, bool swap) : reader(reader), ascii(ascii), swap(swap) {}
+
+    // ASCII 格式下每个元素占一行
+    bool BeginElement() {
+        if (!ascii) return true;
+        return reader.Line(p, end);
+    }
+
+    bool Value(PlyType type, double &value) {
+        if (ascii) {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+            if (p >= end) return false;
+            value = ParseFloat(p, end);
+            return true;
+        }
+
+        unsigned char bytes[8];
+        size_t n = typeSize(type);
+        if (!reader.Read(bytes, n)) return false;
+        if (swap) std::reverse(bytes, bytes + n);
+        switch (type) {
+            case PLY_INT8: value = *(int8_t *) bytes; break;
+            case PLY_UINT8: value = *(uint8_t *) bytes; break;
+            case PLY_INT16: { int16_t v; std::memcpy(&v, bytes, 2); value = v; break; }
+            case PLY_UINT16: { uint16_t v; std::memcpy(&v, bytes, 2); value = v; break; }
+            case PLY_INT32: { int32_t v; std::memcpy(&v, bytes, 4); value = v; break; }
+            case PLY_UINT32: { uint32_t v; std::memcpy(&v, bytes, 4); value = v; break; }
+            case PLY_FLOAT32: { float v; std::memcpy(&v, bytes, 4); value = v; break; }
+            case PLY_FLOAT64: { double v; std::memcpy(&v, bytes, 8); value = v; break; }
+            default: return false;
+        }
+        return true;
+    }
+
+private:
+    ChunkedFileReader &reader;
+    bool ascii;
+    bool swap;
+    const char *p = nullptr;
+    const char *end = nullptr;
+
+    static size_t typeSize(PlyType type) {
+        switch (type) {
+            case PLY_INT8: case PLY_UINT8: return 1;
+            case PLY_INT16: case PLY_UINT16: return 2;
+            case PLY_FLOAT64: return 8;
+            default: return 4;
+        }
+    }
+};
+
+// 支持 ascii / binary_little_endian / binary_big_endian
+// 读取 vertex 的 x y z (nx ny nz) 与 face 的顶点索引列表，其余元素和属性被跳过
+bool StreamPly(const std::string &path, std::vector<glm::vec3> &positions, std::vector<glm::vec3> &normals,
+               std::vector<unsigned int> &indices) {
+    ChunkedFileReader reader;
+    if (!reader.Open(path)) {
+        std::cout << "ERROR::MESH_IMPORT::CANNOT_OPEN " << path << std::endl;
+        return false;
+    }
+
+    // 文件头
+    std::vector<PlyElement> elements;
+    std::string format;
+    const char *p, *end;
+    bool header = true;
+    bool first = true;
+    while (header && reader.Line(p, end)) {
+        std::vector<std::string> tokens;
+        while (p < end) {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+            const char *start = p;
+            while (p < end && *p != ' ' && *p != '\t' && *p != '\r') p++;
+            if (p > start) tokens.push_back(std::string(start, p));
+        }
+        if (first) {
+            if (tokens.size() != 1 || tokens[0] != "ply") break;
+            first = false;
+            continue;
+        }
+        if (tokens.empty()) continue;
+        if (tokens[0] == "format" && tokens.size() >= 2) {
+            format = tokens[1];
+        } else if (tokens[0] == "element" && tokens.size() >= 3) {
+            PlyElement element;
+            element.name = tokens[1];
+            element.count = std::strtoull(tokens[2].c_str(), nullptr, 10);
+            elements.push_back(element);
+        } else if (tokens[0] == "property" && !elements.empty()) {
+            PlyProperty property;
+            if (tokens.size() >= 5 && tokens[1] == "list") {
+                property.countType = ParsePlyType(tokens[2]);
+                property.type = ParsePlyType(tokens[3]);
+                property.name = tokens[4];
+                if (property.countType == PLY_NONE) property.type = PLY_NONE;
+            } else if (tokens.size() >= 3) {
+                property.type = ParsePlyType(tokens[1]);
+                property.name = tokens[2];
+            }
+            if (property.type == PLY_NONE) {
+                std::cout << "ERROR::MESH_IMPORT::PLY_PROPERTY " << path << std::endl;
+                return false;
+            }
+            elements.back().properties.push_back(property);
+        } else if (tokens[0] == "end_header") {
+            header = false;
+        }
+    }
+    bool ascii = format == "ascii";
+    bool bigEndian = format == "binary_big_endian";
+    if (header || (!ascii && !bigEndian && format != "binary_little_endian")) {
+        std::cout << "ERROR::MESH_IMPORT::PLY_HEADER " << path << std::endl;
+        return false;
+    }
+    const uint16_t one = 1;
+    bool littleEndianHost = *(const uint8_t *) &one == 1;
+    PlyValueReader values(reader, ascii, !ascii && bigEndian == littleEndianHost);
+
+    positions.clear();
+    normals.clear();
+    indices.clear();
+    uint64_t nVertices = 0;
+    bool hasNormals = false;
+    for (auto &element: elements) {
+        if (element.name == "vertex") nVertices = element.count;
+        if (element.name == "face") indices.reserve(element.count * 3);
+    }
+
+    std::vector<unsigned int> face;
+    for (auto &element: elements) {
+        bool isVertex = element.name == "vertex";
+        bool isFace = element.name == "face";
+        if (isVertex) {
+            positions.reserve(element.count);
+            for (auto &property: element.properties)
+                if (property.name == "nx") hasNormals = true;
+            if (hasNormals) normals.reserve(element.count);
+        }
+
+        for (uint64_t e = 0; e < element.count; e++) {
+            if (!values.BeginElement()) {
+                std::cout << "ERROR::MESH_IMPORT::PLY_TRUNCATED " << path << std::endl;
+                return false;
+            }
+            glm::vec3 position(0.0f), normal(0.0f);
+            bool faceRead = false;
+            for (auto &property: element.properties) {
+                double value;
+                if (property.countType != PLY_NONE) {
+                    double count;
+                    if (!values.Value(property.countType, count)) {
+                        std::cout << "ERROR::MESH_IMPORT::PLY_TRUNCATED " << path << std::endl;
+                        return false;
+                    }
+                    bool indicesProperty = isFace && !faceRead &&
+                                           (property.name == "vertex_indices" || property.name == "vertex_index");
+                    face.clear();
+                    for (int i = 0; i < (int) count; i++) {
+                        if (!values.Value(property.type, value)) {
+                            std::cout << "ERROR::MESH_IMPORT::PLY_TRUNCATED " << path << std::endl;
+                            return false;
+                        }
+                        if (indicesProperty) {
+                            if (value < 0 || value >= (double) nVertices) {
+                                std::cout << "ERROR::MESH_IMPORT::INVALID_INDEX " << path << std::endl;
+                                return false;
+                            }
+                            face.push_back((unsigned int) value);
+                        }
+                    }
+                    if (indicesProperty) {
+                        faceRead = true;
+                        for (size_t i = 2; i < face.size(); i++) {
+                            indices.push_back(face[0]);
+                            indices.push_back(face[i - 1]);
+                            indices.push_back(face[i]);
+                        }
+                    }
+                    continue;
+                }
+
+                if (!values.Value(property.type, value)) {
+                    std::cout << "ERROR::MESH_IMPORT::PLY_TRUNCATED " << path << std::endl;
+                    return false;
+                }
+                if (!isVertex) continue;
+                const std::string &name = property.name;
+                if (name == "x") position.x = (float) value;
+                else if (name == "y") position.y = (float) value;
+                else if (name == "z") position.z = (float) value;
+                else if (name == "nx") normal.x = (float) value;
+                else if (name == "ny") normal.y = (float) value;
+                else if (name == "nz") normal.z = (float) value;
+            }
+            if (isVertex) {
+                positions.push_back(position);
+                if (hasNormals) normals.push_back(normal);
+            }
+        }
+    }
+
+    if (!hasNormals) ComputeSmoothNormals(positions, indices, normals);
+    return true;
+}
+
+// 流式导入 OBJ 或 PLY
+bool StreamImportMesh(const std::string &path, std::vector<glm::vec3> &positions, std::vector<glm::vec3> &normals,
+                      std::vector<unsigned int> &indices) {
+    auto start = std::chrono::high_resolution_clock::now();
+    bool ok = IsPlyFile(path) ? StreamPly(path, positions, normals, indices)
+                              : StreamObj(path, positions, normals, indices);
+    if (!ok) return false;
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "Mesh streamed: " << path << " (" << positions.size() << " vertices, " << indices.size() / 3
+              << " triangles) in " << ms << " ms, " << MESH_IMPORT_CHUNK_BYTES / (1 << 20) << " MB chunks" << std::endl;
+    return true;
+}
+
+#endif //MESH_STREAM_IMPORT_H
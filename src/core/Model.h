@@ -11,13 +11,16 @@
 #include <assimp/postprocess.h>
 
 #include "Mesh.h"
+#include "ObjLoader.h"
 #include "Shader.h"
+#include "TexturePool.h"
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 using namespace std;
@@ -31,9 +34,10 @@ public:
     vector<Mesh> meshes;
     string directory;
     bool gammaCorrection;
+    bool setupGL;   // false: 只导入几何和纹理路径，不创建 GL 缓冲和纹理
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma) {
+    Model(string const &path, bool gamma = false, bool setupGL = true) : gammaCorrection(gamma), setupGL(setupGL) {
         loadModel(path);
     }
 
@@ -44,8 +48,24 @@ public:
     }
 
 private:
+    unordered_map<string, size_t> loadedIndex;  // texture path -> index in textures_loaded
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path) {
+        // OBJ 使用多线程加载器，其它格式、引用了材质（.mtl）的 OBJ 以及加载失败时回退到 Assimp
+        // 多线程加载器不解析材质，引用材质的文件交给 Assimp 才能读到 .mtl 中的纹理
+        if (IsObjFile(path)) {
+            vector<Vertex> vertices;
+            vector<unsigned int> indices;
+            bool usesMaterials = false;
+            if (LoadObj(path, vertices, indices, true, &usesMaterials)) {
+                directory = path.substr(0, path.find_last_of('/'));
+                meshes.push_back(Mesh(std::move(vertices), std::move(indices), vector<Texture>(), setupGL));
+                return;
+            }
+            if (usesMaterials) cout << "OBJ references materials, loading with Assimp: " << path << endl;
+        }
+
         // read file via ASSIMP
         Assimp::Importer importer;
         const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals |
@@ -155,7 +175,7 @@ private:
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
         // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return Mesh(std::move(vertices), std::move(indices), std::move(textures), setupGL);
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -166,23 +186,20 @@ private:
             aiString str;
             mat->GetTexture(type, i, &str);
             // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for (unsigned int j = 0; j < textures_loaded.size(); j++) {
-                if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0) {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if (!skip) {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(
-                        texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+            auto loaded = loadedIndex.find(str.C_Str());
+            if (loaded != loadedIndex.end()) {
+                textures.push_back(textures_loaded[loaded->second]);
+                continue;
             }
+            // 纹理在 TexturePool 的工作线程中解码，由绘制 Model 的一方每帧调用 GetTexturePool().Update() 经 PBO 上传，此处只取得纹理名
+            Texture texture;
+            texture.id = setupGL ? GetTexturePool().Request(this->directory + '/' + str.C_Str()) : 0;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
+            loadedIndex[texture.path] = textures_loaded.size();
+            textures_loaded.push_back(
+                    texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
         }
         return textures;
     }
@@ -0,0 +1,406 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <glm/glm.hpp>
+
+#include "Mesh.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// OBJ 快速加载
+// 文件被内存映射后按行边界切分为若干块，每块在独立线程中解析，随后合并并解析索引
+// 仅处理 v / vt / vn / f，其余语句（o、g、s 等）被忽略，所有面合并为一个网格
+// 材质不在这里解析，只记录文件是否引用了材质（mtllib、usemtl），由调用方决定是否交给 Assimp
+// 多边形面按扇形三角化，缺少法线的顶点按面积加权生成平滑法线
+
+// 扩展名是否为 .obj（不区分大小写）
+bool IsObjFile(const std::string &path) {
+    if (path.size() < 4) return false;
+    std::string ext = path.substr(path.size() - 4);
+    for (auto &c: ext) c = (char) tolower((unsigned char) c);
+    return ext == ".obj";
+}
+
+// 解析浮点数，p 前进到数字之后
+// 有效数字累加到 64 位整数后一次缩放，精度足够 float 使用
+float ParseFloat(const char *&p, const char *end) {
+    static const double powers[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+            1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa != 0) digits++;
+        } else {
+            exponent++;
+        }
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa != 0) digits++;
+                exponent--;
+            }
+            p++;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool expNegative = false;
+        if (p < end && (*p == '-' || *p == '+')) expNegative = *p++ == '-';
+        int e = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (e < 10000) e = e * 10 + (*p - '0');
+            p++;
+        }
+        exponent += expNegative ? -e : e;
+    }
+
+    double value = (double) mantissa;
+    while (exponent > 22) {
+        value *= 1e22;
+        exponent -= 22;
+    }
+    while (exponent < -22) {
+        value /= 1e22;
+        exponent += 22;
+    }
+    value = exponent >= 0 ? value * powers[exponent] : value / powers[-exponent];
+    return (float) (negative ? -value : value);
+}
+
+// 解析有符号整数，没有数字时返回 0
+int ParseInt(const char *&p, const char *end) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) negative = *p++ == '-';
+    int value = 0;
+    while (p < end && *p >= '0' && *p <= '9') value = value * 10 + (*p++ - '0');
+    return negative ? -value : value;
+}
+
+#define OBJ_NO_INDEX INT_MIN
+
+#define OBJ_RELATIVE_V 1
+#define OBJ_RELATIVE_VT 2
+#define OBJ_RELATIVE_VN 4
+
+// 面的一个顶点，v / vt / vn 为索引，缺省时为 OBJ_NO_INDEX
+// relative 标记哪些索引是相对本块起始的下标（由负数索引得到，可能指向之前的块），合并时加上块的起始下标
+struct ObjCorner {
+    int v, vt, vn;
+    int relative;
+};
+
+// 每个线程解析得到的数据
+// 正数索引直接记为全局下标，负数索引记为相对本块起始的下标，合并后再解析为全局下标
+struct ObjChunk {
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec3> normals;
+    std::vector<ObjCorner> corners;     // 三角化后的面，每 3 个一组
+    bool materials = false;             // 出现 mtllib 或 usemtl
+    bool error = false;
+};
+
+// OBJ 索引转为块内编码，0 为非法索引
+// 负数索引 -k 指向当前位置之前的第 k 个元素，记为 localCount - k，小于 0 时落在之前的块中
+bool EncodeObjIndex(int index, int localCount, int flag, int &encoded, int &relative) {
+    if (index > 0) {
+        encoded = index - 1;
+        return true;
+    }
+    if (index < 0) {
+        encoded = localCount + index;
+        relative |= flag;
+        return true;
+    }
+    return false;
+}
+
+// 行首是否为指定的关键字
+bool IsObjKeyword(const char *p, const char *lineEnd, const char *keyword, size_t length) {
+    return (size_t) (lineEnd - p) > length && memcmp(p, keyword, length) == 0 && (p[length] == ' ' || p[length] == '\t');
+}
+
+void ParseObjChunk(const char *p, const char *end, ObjChunk &chunk) {
+    std::vector<ObjCorner> face;
+    while (p < end) {
+        // 跳过行首空白
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        const char *lineEnd = p;
+        while (lineEnd < end && *lineEnd != '\n') lineEnd++;
+
+        if (lineEnd - p >= 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            p += 2;
+            glm::vec3 v;
+            for (int i = 0; i < 3; i++) {
+                while (p < lineEnd && (*p == ' ' || *p == '\t')) p++;
+                v[i] = ParseFloat(p, lineEnd);
+            }
+            chunk.positions.push_back(v);
+        } else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t')) {
+            p += 3;
+            glm::vec3 n;
+            for (int i = 0; i < 3; i++) {
+                while (p < lineEnd && (*p == ' ' || *p == '\t')) p++;
+                n[i] = ParseFloat(p, lineEnd);
+            }
+            chunk.normals.push_back(n);
+        } else if (lineEnd - p >= 3 && p[0] == 'v' && p[1] == 't' && (p[2] == ' ' || p[2] == '\t')) {
+            p += 3;
+            glm::vec2 t;
+            for (int i = 0; i < 2; i++) {
+                while (p < lineEnd && (*p == ' ' || *p == '\t')) p++;
+                t[i] = ParseFloat(p, lineEnd);
+            }
+            chunk.texCoords.push_back(t);
+        } else if (lineEnd - p >= 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            p += 2;
+            face.clear();
+            while (true) {
+                while (p < lineEnd && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+                if (p >= lineEnd) break;
+
+                // v、v/vt、v//vn、v/vt/vn
+                ObjCorner c{OBJ_NO_INDEX, OBJ_NO_INDEX, OBJ_NO_INDEX, 0};
+                int v = ParseInt(p, lineEnd);
+                bool ok = EncodeObjIndex(v, chunk.positions.size(), OBJ_RELATIVE_V, c.v, c.relative);
+                if (p < lineEnd && *p == '/') {
+                    p++;
+                    if (p < lineEnd && *p != '/') {
+                        ok = ok && EncodeObjIndex(ParseInt(p, lineEnd), chunk.texCoords.size(), OBJ_RELATIVE_VT, c.vt, c.relative);
+                    }
+                    if (p < lineEnd && *p == '/') {
+                        p++;
+                        ok = ok && EncodeObjIndex(ParseInt(p, lineEnd), chunk.normals.size(), OBJ_RELATIVE_VN, c.vn, c.relative);
+                    }
+                }
+                if (!ok) {
+                    chunk.error = true;
+                    break;
+                }
+                face.push_back(c);
+                while (p < lineEnd && *p != ' ' && *p != '\t' && *p != '\r') p++;
+            }
+
+            // 扇形三角化
+            for (size_t i = 2; i < face.size(); i++) {
+                chunk.corners.push_back(face[0]);
+                chunk.corners.push_back(face[i - 1]);
+                chunk.corners.push_back(face[i]);
+            }
+        } else if (IsObjKeyword(p, lineEnd, "mtllib", 6) || IsObjKeyword(p, lineEnd, "usemtl", 6)) {
+            chunk.materials = true;
+        }
+
+        p = lineEnd + 1;
+    }
+}
+
+// 块内编码的索引转为全局下标，越界时返回 false
+bool ResolveObjIndex(int &index, bool relative, int base, int count) {
+    if (relative) index += base;
+    return index >= 0 && index < count;
+}
+
+// 读取 OBJ 文件，输出合并后的顶点和索引数组
+// 相同 (v, vt, vn) 组合的顶点只保留一份，flipUVs 与 aiProcess_FlipUVs 一致
+// usesMaterials 非空时，文件引用了材质则置为 true 并在合并前返回 false，由调用方改用能读取 .mtl 的加载器
+bool LoadObj(const std::string &path, std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+             bool flipUVs = true, bool *usesMaterials = nullptr) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    MappedFile file;
+    if (!file.Open(path)) {
+        std::cout << "ERROR::OBJ_LOADER::CANNOT_OPEN " << path << std::endl;
+        return false;
+    }
+    file.AdviseSequential();
+    const char *data = reinterpret_cast<const char *>(file.Data());
+    const char *end = data + file.Size();
+
+    // 按行边界切块，每个线程一块：ParallelFor 为每个线程分配固定的连续区间，多切块并不能平衡负载
+    size_t nChunks = std::min<size_t>(GetWorkerCount(), file.Size() / (1 << 16) + 1);
+    std::vector<const char *> bounds(1, data);
+    for (size_t i = 1; i < nChunks; i++) {
+        const char *p = std::max(bounds.back(), data + file.Size() * i / nChunks);
+        while (p < end && *p != '\n') p++;
+        if (p < end) p++;
+        if (p > bounds.back() && p < end) bounds.push_back(p);
+    }
+    bounds.push_back(end);
+    nChunks = bounds.size() - 1;
+
+    std::vector<ObjChunk> chunks(nChunks);
+    ParallelFor(0, nChunks, 1, [&](int chunkBegin, int chunkEnd) {
+        for (int i = chunkBegin; i < chunkEnd; i++) ParseObjChunk(bounds[i], bounds[i + 1], chunks[i]);
+    });
+
+    if (usesMaterials != nullptr) {
+        *usesMaterials = false;
+        for (const ObjChunk &chunk: chunks) *usesMaterials = *usesMaterials || chunk.materials;
+        if (*usesMaterials) return false;
+    }
+
+    // 各块的起始下标
+    std::vector<int> vBase(nChunks), vtBase(nChunks), vnBase(nChunks);
+    size_t nPositions = 0, nTexCoords = 0, nNormals = 0, nCorners = 0;
+    for (size_t i = 0; i < nChunks; i++) {
+        if (chunks[i].error) {
+            std::cout << "ERROR::OBJ_LOADER::INVALID_INDEX " << path << std::endl;
+            return false;
+        }
+        vBase[i] = nPositions;
+        vtBase[i] = nTexCoords;
+        vnBase[i] = nNormals;
+        nPositions += chunks[i].positions.size();
+        nTexCoords += chunks[i].texCoords.size();
+        nNormals += chunks[i].normals.size();
+        nCorners += chunks[i].corners.size();
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec2> texCoords;
+    std::vector<glm::vec3> normals;
+    std::vector<ObjCorner> corners;
+    positions.reserve(nPositions);
+    texCoords.reserve(nTexCoords);
+    normals.reserve(nNormals);
+    corners.reserve(nCorners);
+    bool valid = true;
+    for (size_t i = 0; i < nChunks; i++) {
+        ObjChunk &chunk = chunks[i];
+        positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+        texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        for (auto c: chunk.corners) {
+            valid = valid && ResolveObjIndex(c.v, c.relative & OBJ_RELATIVE_V, vBase[i], nPositions);
+            if (c.vt != OBJ_NO_INDEX) valid = valid && ResolveObjIndex(c.vt, c.relative & OBJ_RELATIVE_VT, vtBase[i], nTexCoords);
+            if (c.vn != OBJ_NO_INDEX) valid = valid && ResolveObjIndex(c.vn, c.relative & OBJ_RELATIVE_VN, vnBase[i], nNormals);
+            c.relative = 0;
+            corners.push_back(c);
+        }
+        chunk = ObjChunk();
+    }
+    chunks.clear();
+    if (!valid) {
+        std::cout << "ERROR::OBJ_LOADER::INDEX_OUT_OF_RANGE " << path << std::endl;
+        return false;
+    }
+
+    vertices.clear();
+    indices.clear();
+    indices.resize(corners.size());
+
+    bool hasTexCoords = !texCoords.empty();
+    bool hasNormals = !normals.empty();
+    bool deduplicate = hasTexCoords || hasNormals;
+    if (!deduplicate) {
+        // 只有位置时顶点与位置一一对应，无需去重
+        vertices.resize(positions.size());
+        ParallelFor(0, corners.size(), 1 << 16, [&](int l, int r) {
+            for (int i = l; i < r; i++) indices[i] = corners[i].v;
+        });
+    } else {
+        // (v, vt, vn) 组合去重
+        struct CornerHash {
+            size_t operator()(const ObjCorner &c) const {
+                uint64_t h = (uint64_t) (uint32_t) c.v * 0x9E3779B97F4A7C15ull;
+                h ^= (uint64_t) (uint32_t) c.vt * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+                h ^= (uint64_t) (uint32_t) c.vn * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+                return (size_t) h;
+            }
+        };
+        struct CornerEqual {
+            bool operator()(const ObjCorner &a, const ObjCorner &b) const {
+                return a.v == b.v && a.vt == b.vt && a.vn == b.vn;
+            }
+        };
+        std::unordered_map<ObjCorner, unsigned int, CornerHash, CornerEqual> unique;
+        unique.reserve(positions.size() * 2);
+        std::vector<ObjCorner> vertexCorners;
+        vertexCorners.reserve(positions.size());
+        for (size_t i = 0; i < corners.size(); i++) {
+            auto it = unique.insert(std::make_pair(corners[i], (unsigned int) vertexCorners.size()));
+            if (it.second) vertexCorners.push_back(corners[i]);
+            indices[i] = it.first->second;
+        }
+        vertices.resize(vertexCorners.size());
+        ParallelFor(0, vertexCorners.size(), 1 << 16, [&](int l, int r) {
+            for (int i = l; i < r; i++) {
+                const ObjCorner &c = vertexCorners[i];
+                Vertex &v = vertices[i];
+                v.Position = positions[c.v];
+                v.Normal = c.vn >= 0 ? normals[c.vn] : glm::vec3(0.0f);
+                v.TexCoords = c.vt >= 0 ? texCoords[c.vt] : glm::vec2(0.0f);
+                if (flipUVs) v.TexCoords.y = 1.0f - v.TexCoords.y;
+                v.Tangent = v.Bitangent = glm::vec3(0.0f);
+            }
+        });
+        corners.swap(vertexCorners);
+    }
+
+    if (!deduplicate) {
+        ParallelFor(0, vertices.size(), 1 << 16, [&](int l, int r) {
+            for (int i = l; i < r; i++) {
+                vertices[i].Position = positions[i];
+                vertices[i].Normal = glm::vec3(0.0f);
+                vertices[i].TexCoords = glm::vec2(0.0f);
+                vertices[i].Tangent = vertices[i].Bitangent = glm::vec3(0.0f);
+            }
+        });
+    }
+
+    // 缺少法线的顶点（整个文件没有 vn，或面中省略了 vn）按位置生成平滑法线：同一位置累加相邻面的面积加权法线
+    // 去重后 corners[i] 为顶点 i 的 (v, vt, vn)，未去重时顶点 i 即位置 i
+    bool missingNormals = !hasNormals;
+    for (size_t i = 0; i < corners.size() && !missingNormals; i++) missingNormals = corners[i].vn == OBJ_NO_INDEX;
+    if (missingNormals) {
+        std::vector<glm::vec3> accumulated(positions.size(), glm::vec3(0.0f));
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            const glm::vec3 &p1 = vertices[indices[i]].Position;
+            const glm::vec3 &p2 = vertices[indices[i + 1]].Position;
+            const glm::vec3 &p3 = vertices[indices[i + 2]].Position;
+            glm::vec3 n = glm::cross(p2 - p1, p3 - p1);
+            for (int k = 0; k < 3; k++) {
+                unsigned int vi = indices[i + k];
+                accumulated[deduplicate ? corners[vi].v : vi] += n;
+            }
+        }
+        ParallelFor(0, vertices.size(), 1 << 16, [&](int l, int r) {
+            for (int i = l; i < r; i++) {
+                if (deduplicate && corners[i].vn != OBJ_NO_INDEX) continue;
+                glm::vec3 n = accumulated[deduplicate ? corners[i].v : i];
+                float len = glm::length(n);
+                vertices[i].Normal = len > 0.0f ? n / len : glm::vec3(0.0f);
+            }
+        });
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::cout << "OBJ loaded: " << path << " (" << vertices.size() << " vertices, " << indices.size() / 3
+              << " triangles) in " << ms << " ms, " << file.Size() / (ms * 1000.0) << " MB/s" << std::endl;
+    return true;
+}
+
+#endif //OBJ_LOADER_H
@@ -0,0 +1,40 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// 可用的工作线程数量
+unsigned int GetWorkerCount() {
+    static unsigned int count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+// 将 [begin, end) 切分为连续的块，并行执行 func(chunkBegin, chunkEnd)
+// grain: 每块的最少元素数量，任务量不足时直接在当前线程执行
+template<typename Func>
+void ParallelFor(int begin, int end, int grain, Func func) {
+    int count = end - begin;
+    if (count <= 0) return;
+
+    int nChunks = std::min((int) GetWorkerCount(), (count + grain - 1) / grain);
+    if (nChunks <= 1) {
+        func(begin, end);
+        return;
+    }
+
+    int chunk = (count + nChunks - 1) / nChunks;
+    std::vector<std::thread> workers;
+    workers.reserve(nChunks - 1);
+    for (int l = begin + chunk; l < end; l += chunk) {
+        workers.emplace_back(func, l, std::min(end, l + chunk));
+    }
+
+    // 第一块在当前线程执行
+    func(begin, std::min(end, begin + chunk));
+
+    for (auto &worker: workers) worker.join();
+}
+
+#endif //PARALLEL_H
@@ -0,0 +1,149 @@
+#ifndef PREETHAM_SKY_H
+#define PREETHAM_SKY_H
+
+#include <glm/glm.hpp>
+
+#include "EnvAliasTable.h"
+#include "EnvRotation.h"
+#include "EnvSun.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Preetham 解析天空模型 (A Practical Analytic Model for Daylight, 1999)
+// 天空的 Y (kcd/m^2)、x、y 由 Perez 分布给出：F(theta, gamma) / F(0, theta_s) 乘以天顶的值，theta 为与天顶的夹角，gamma 为与太阳的夹角
+// 着色器中逐方向解析计算，不占用贴图显存；CPU 只计算系数，并在低分辨率网格上求值建立别名表用于重要性采样
+// 太阳作为圆盘光源复用 EnvSun，辐亮度按 Rayleigh 与气溶胶（Angstrom 公式）的光学厚度衰减
+// 方向均在贴图空间中，与环境贴图经过同一个 envAngle 旋转
+
+#define PREETHAM_SKY_WIDTH          128     // 采样表的分辨率，与天空的平滑程度相比足够
+#define PREETHAM_SKY_HEIGHT         64
+#define PREETHAM_SUN_RADIUS         0.2666  // 太阳的角半径（度）
+#define PREETHAM_SUN_LUMINANCE      2.0e6   // 大气层外太阳的亮度 (kcd/m^2)
+#define PREETHAM_GROUND_ALBEDO      0.3     // 地平线以下以地平线的天空乘以地面反照率近似
+
+class PreethamSky {
+public:
+    // 参数
+    float turbidity = 2.5f;             // 浑浊度，2 为晴朗，10 为雾霾
+    float sunElevation = 30.0f;         // 太阳高度角（度）
+    float sunAzimuth = 0.0f;            // 太阳方位角（度），0 对应贴图中心 u = 0.5
+    float intensity = 0.05f;            // kcd/m^2 到渲染单位的缩放
+
+    // 导出给着色器的系数，分量依次对应 Y、x、y
+    glm::vec3 perez[5];                 // Perez 分布的 A ~ E
+    glm::vec3 zenithScale;              // 天顶的值除以 F(0, theta_s)，Y 分量已乘以 intensity
+    glm::vec3 sunDirection;             // 贴图空间
+    EnvSun sun;
+
+    // width x (height + 1) 的别名表，布局与 calculateHdrAliasTable 相同
+    std::vector<float> aliasTable;
+
+    // 由参数重新计算系数与采样表
+    void Update() {
+        float T = turbidity;
+        float elevation = glm::radians(std::min(std::max(sunElevation, 0.5f), 90.0f));
+        float azimuth = glm::radians(sunAzimuth);
+        float thetaS = (float) (ENV_PI / 2.0) - elevation;
+        sunDirection = EnvUvToDirection(glm::vec2(0.5f + azimuth / (float) (2.0 * ENV_PI), 0.5f - elevation / (float) ENV_PI), 0.0f);
+
+        perez[0] = glm::vec3(0.1787f * T - 1.4630f, -0.0193f * T - 0.2592f, -0.0167f * T - 0.2608f);
+        perez[1] = glm::vec3(-0.3554f * T + 0.4275f, -0.0665f * T + 0.0008f, -0.0950f * T + 0.0092f);
+        perez[2] = glm::vec3(-0.0227f * T + 5.3251f, -0.0004f * T + 0.2125f, -0.0079f * T + 0.2102f);
+        perez[3] = glm::vec3(0.1206f * T - 2.5771f, -0.0641f * T - 0.8989f, -0.0441f * T - 1.6537f);
+        perez[4] = glm::vec3(-0.0670f * T + 0.3703f, -0.0033f * T + 0.0452f, -0.0109f * T + 0.0529f);
+
+        // 天顶的亮度与色度
+        float chi = (4.0f / 9.0f - T / 120.0f) * ((float) ENV_PI - 2.0f * thetaS);
+        float Yz = (4.0453f * T - 4.9710f) * std::tan(chi) - 0.2155f * T + 2.4192f;
+        float t3 = thetaS * thetaS * thetaS, t2 = thetaS * thetaS;
+        float xz = (0.00166f * t3 - 0.00375f * t2 + 0.00209f * thetaS) * T * T +
+                   (-0.02903f * t3 + 0.06377f * t2 - 0.03202f * thetaS + 0.00394f) * T +
+                   (0.11693f * t3 - 0.21196f * t2 + 0.06052f * thetaS + 0.25886f);
+        float yz = (0.00275f * t3 - 0.00610f * t2 + 0.00317f * thetaS) * T * T +
+                   (-0.04214f * t3 + 0.08970f * t2 - 0.04153f * thetaS + 0.00516f) * T +
+                   (0.15346f * t3 - 0.26756f * t2 + 0.06670f * thetaS + 0.26688f);
+        glm::vec3 F0 = perezF(1.0f, thetaS);     // 天顶方向：theta = 0，gamma = theta_s
+        zenithScale = glm::vec3(std::max(Yz, 0.0f) * intensity, xz, yz) / F0;
+
+        // 低分辨率网格上求值并建立别名表，同时积分天空的功率
+        std::vector<float> radiance((size_t) PREETHAM_SKY_WIDTH * PREETHAM_SKY_HEIGHT * 3);
+        double skyPower = 0.0;
+        for (int i = 0; i < PREETHAM_SKY_HEIGHT; i++) {
+            double sinTheta = std::sin(ENV_PI * (i + 0.5) / PREETHAM_SKY_HEIGHT);
+            for (int j = 0; j < PREETHAM_SKY_WIDTH; j++) {
+                glm::vec2 uv((j + 0.5f) / PREETHAM_SKY_WIDTH, (i + 0.5f) / PREETHAM_SKY_HEIGHT);
+                glm::vec3 c = Radiance(EnvUvToDirection(uv, 0.0f));
+                float *out = &radiance[3 * ((size_t) i * PREETHAM_SKY_WIDTH + j)];
+                out[0] = c.x;
+                out[1] = c.y;
+                out[2] = c.z;
+                skyPower += HdrLuminance(out) * sinTheta;
+            }
+        }
+        skyPower *= (2.0 * ENV_PI / PREETHAM_SKY_WIDTH) * (ENV_PI / PREETHAM_SKY_HEIGHT);
+        float *table = calculateHdrAliasTable(radiance.data(), PREETHAM_SKY_WIDTH, PREETHAM_SKY_HEIGHT);
+        aliasTable.assign(table, table + (size_t) PREETHAM_SKY_WIDTH * (PREETHAM_SKY_HEIGHT + 1) * 3);
+        delete[] table;
+
+        updateSun(thetaS, skyPower);
+    }
+
+    // 贴图空间方向 v 的天空辐亮度（线性 sRGB），不含太阳圆盘，与着色器中的 skyRadiance 一致
+    glm::vec3 Radiance(const glm::vec3 &v) const {
+        float cosTheta = std::max(v.y, 0.001f);
+        float gamma = std::acos(std::min(std::max(glm::dot(v, sunDirection), -1.0f), 1.0f));
+        glm::vec3 Yxy = zenithScale * perezF(cosTheta, gamma);
+        glm::vec3 rgb = xyYToRGB(Yxy.y, Yxy.z, Yxy.x);
+        return v.y < 0.0f ? rgb * (float) PREETHAM_GROUND_ALBEDO : rgb;
+    }
+
+    static glm::vec3 xyYToRGB(float x, float y, float Y) {
+        float X = x / std::max(y, 1e-6f) * Y;
+        float Z = (1.0f - x - y) / std::max(y, 1e-6f) * Y;
+        return glm::max(glm::vec3(3.2404542f * X - 1.5371385f * Y - 0.4985314f * Z,
+                                  -0.9692660f * X + 1.8760108f * Y + 0.0415560f * Z,
+                                  0.0556434f * X - 0.2040259f * Y + 1.0572252f * Z), glm::vec3(0.0f));
+    }
+
+private:
+    // 视线与天顶夹角余弦为 cosTheta、与太阳夹角为 gamma 时的 Perez 分布
+    glm::vec3 perezF(float cosTheta, float gamma) const {
+        glm::vec3 F;
+        for (int c = 0; c < 3; c++) {
+            F[c] = (1.0f + perez[0][c] * std::exp(perez[1][c] / cosTheta)) *
+                   (1.0f + perez[2][c] * std::exp(perez[3][c] * gamma) + perez[4][c] * std::cos(gamma) * std::cos(gamma));
+        }
+        return F;
+    }
+
+    // 太阳圆盘：大气层外的亮度按 R、G、B 对应波长 (0.68, 0.55, 0.44 um) 的光学厚度衰减
+    // Rayleigh: 0.008735 lambda^-4.08，气溶胶: beta lambda^-1.3，beta = 0.04608 T - 0.04586，相对大气质量按 Kasten 公式
+    void updateSun(float thetaS, double skyPower) {
+        const float lambda[3] = {0.68f, 0.55f, 0.44f};
+        float beta = 0.04608f * turbidity - 0.04586f;
+        float thetaDeg = glm::degrees(thetaS);
+        float airMass = 1.0f / (std::cos(thetaS) + 0.15f * std::pow(93.885f - thetaDeg, -1.253f));
+        glm::vec3 transmittance;
+        for (int c = 0; c < 3; c++) {
+            float tau = 0.008735f * std::pow(lambda[c], -4.08f) + beta * std::pow(lambda[c], -1.3f);
+            transmittance[c] = std::exp(-tau * airMass);
+        }
+
+        double cosAngle = std::cos(PREETHAM_SUN_RADIUS * ENV_PI / 180.0);
+        sun = EnvSun();
+        sun.found = true;
+        sun.direction = sunDirection;
+        sun.radiance = transmittance * (float) (PREETHAM_SUN_LUMINANCE * intensity);
+        sun.cosAngle = (float) cosAngle;
+        sun.solidAngle = (float) (2.0 * ENV_PI * (1.0 - cosAngle));
+
+        // 采样太阳的概率取太阳占天空与太阳总功率的比例
+        double sunPower = HdrLuminance(&sun.radiance[0]) * sun.solidAngle;
+        sun.powerFraction = sunPower + skyPower > 0.0 ? (float) (sunPower / (sunPower + skyPower)) : 0.0f;
+        sun.sampleProbability = std::min(std::max(sun.powerFraction, 0.1f), 0.9f);
+    }
+};
+
+#endif //PREETHAM_SKY_H
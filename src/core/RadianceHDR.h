@@ -0,0 +1,281 @@
+#ifndef RADIANCE_HDR_H
+#define RADIANCE_HDR_H
+
+#include "Parallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RADIANCE_HDR_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RADIANCE_HDR_NEON
+#endif
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Radiance RGBE (.hdr) 解码，代替 thirdparty/hdrloader 逐字节 fgetc 的读取，结果写入 HDRLoaderResult（需在 hdrloader.h 之后包含）
+// 输入为内存映射的文件；先串行扫描一遍得到每行 RLE 数据的起始位置，再按行并行解码
+// RGBE 到浮点的转换与 thirdparty/hdrloader 逐位一致：c = v / 256 * 2^(e - 128)，e = 0 时不作特殊处理
+// 转换在 x86 上使用 SSE2、在 ARM 上使用 NEON 成组处理，其它平台为标量
+
+// 单个 RGBE 像素转为浮点 RGB
+void convertRGBEPixel(const unsigned char *p, float *col) {
+    float scale = std::ldexp(1.0f, (int) p[3] - 136);
+    col[0] = p[0] * scale;
+    col[1] = p[1] * scale;
+    col[2] = p[2] * scale;
+}
+
+// 一行 RGBE 像素转为浮点 RGB
+void convertRGBEScanline(const unsigned char *rgbe, int width, float *cols) {
+    int x = 0;
+#ifdef RADIANCE_HDR_SSE2
+    // 每次处理 4 个像素：指数拼成 2^(e - 136) 的浮点位，尾数转浮点后相乘，再交错写出 12 个分量
+    // 指数过小（e < 10，结果为非规格化数）的组交给标量处理
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 4 <= width; x += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgbe + 4 * x));
+        __m128i lo = _mm_unpacklo_epi8(pixels, zero);
+        __m128i hi = _mm_unpackhi_epi8(pixels, zero);
+        __m128i p0 = _mm_unpacklo_epi16(lo, zero);      // R G B E of pixel 0
+        __m128i p1 = _mm_unpackhi_epi16(lo, zero);
+        __m128i p2 = _mm_unpacklo_epi16(hi, zero);
+        __m128i p3 = _mm_unpackhi_epi16(hi, zero);
+
+        __m128i e = _mm_srli_epi32(pixels, 24);
+        if (_mm_movemask_epi8(_mm_cmplt_epi32(e, _mm_set1_epi32(10))) != 0) {
+            for (int k = x; k < x + 4; k++) convertRGBEPixel(rgbe + 4 * k, cols + 3 * k);
+            continue;
+        }
+        __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(e, _mm_set1_epi32(9)), 23));
+
+        __m128 s0 = _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(0, 0, 0, 0));
+        __m128 s1 = _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(1, 1, 1, 1));
+        __m128 s2 = _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(2, 2, 2, 2));
+        __m128 s3 = _mm_shuffle_ps(scale, scale, _MM_SHUFFLE(3, 3, 3, 3));
+        __m128 c0 = _mm_mul_ps(_mm_cvtepi32_ps(p0), s0);   // r0 g0 b0 -
+        __m128 c1 = _mm_mul_ps(_mm_cvtepi32_ps(p1), s1);   // r1 g1 b1 -
+        __m128 c2 = _mm_mul_ps(_mm_cvtepi32_ps(p2), s2);   // r2 g2 b2 -
+        __m128 c3 = _mm_mul_ps(_mm_cvtepi32_ps(p3), s3);   // r3 g3 b3 -
+
+        // 去掉每个像素的第 4 个分量：r0 g0 b0 r1 | g1 b1 r2 g2 | b2 r3 g3 b3
+        __m128 t0 = _mm_shuffle_ps(c1, c0, _MM_SHUFFLE(2, 2, 0, 0));                   // r1 r1 b0 b0
+        __m128 o0 = _mm_shuffle_ps(c0, t0, _MM_SHUFFLE(0, 2, 1, 0));                   // r0 g0 b0 r1
+        __m128 o1 = _mm_shuffle_ps(c1, c2, _MM_SHUFFLE(1, 0, 2, 1));                   // g1 b1 r2 g2
+        __m128 t2 = _mm_shuffle_ps(c2, c3, _MM_SHUFFLE(0, 0, 2, 2));                   // b2 b2 r3 r3
+        __m128 o2 = _mm_shuffle_ps(t2, c3, _MM_SHUFFLE(2, 1, 2, 0));                   // b2 r3 g3 b3
+        _mm_storeu_ps(cols + 3 * x, o0);
+        _mm_storeu_ps(cols + 3 * x + 4, o1);
+        _mm_storeu_ps(cols + 3 * x + 8, o2);
+    }
+#elif defined(RADIANCE_HDR_NEON)
+    // 每次处理 8 个像素：vld4 按分量拆开 R、G、B、E，与 SSE2 路径相同地由指数拼出 2^(e - 136)，
+    // 每 4 个像素相乘后由 vst3q 交错写出 12 个分量；指数过小的组交给标量处理
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x4_t pixels = vld4_u8(rgbe + 4 * x);
+        uint8x8_t minE = vpmin_u8(pixels.val[3], pixels.val[3]);
+        minE = vpmin_u8(minE, minE);
+        minE = vpmin_u8(minE, minE);
+        if (vget_lane_u8(minE, 0) < 10) {
+            for (int k = x; k < x + 8; k++) convertRGBEPixel(rgbe + 4 * k, cols + 3 * k);
+            continue;
+        }
+
+        uint16x8_t r = vmovl_u8(pixels.val[0]);
+        uint16x8_t g = vmovl_u8(pixels.val[1]);
+        uint16x8_t b = vmovl_u8(pixels.val[2]);
+        uint16x8_t e = vmovl_u8(pixels.val[3]);
+        for (int half = 0; half < 2; half++) {
+            uint16x4_t r4 = half == 0 ? vget_low_u16(r) : vget_high_u16(r);
+            uint16x4_t g4 = half == 0 ? vget_low_u16(g) : vget_high_u16(g);
+            uint16x4_t b4 = half == 0 ? vget_low_u16(b) : vget_high_u16(b);
+            uint16x4_t e4 = half == 0 ? vget_low_u16(e) : vget_high_u16(e);
+            float32x4_t scale = vreinterpretq_f32_u32(vshlq_n_u32(vsubq_u32(vmovl_u16(e4), vdupq_n_u32(9)), 23));
+            float32x4x3_t c;
+            c.val[0] = vmulq_f32(vcvtq_f32_u32(vmovl_u16(r4)), scale);
+            c.val[1] = vmulq_f32(vcvtq_f32_u32(vmovl_u16(g4)), scale);
+            c.val[2] = vmulq_f32(vcvtq_f32_u32(vmovl_u16(b4)), scale);
+            vst3q_f32(cols + 3 * (x + 4 * half), c);
+        }
+    }
+#endif
+    for (; x < width; x++) convertRGBEPixel(rgbe + 4 * x, cols + 3 * x);
+}
+
+// 当前位置是否为新格式 RLE 行的行首：2, 2, 宽度高位, 宽度低位
+bool isRLEScanline(const unsigned char *p, const unsigned char *end, int width) {
+    if (width < 8 || width > 0x7fff || end - p < 4) return false;
+    return p[0] == 2 && p[1] == 2 && !(p[2] & 128) && ((p[2] << 8) | p[3]) == width;
+}
+
+// 跳过一行新格式 RLE 数据，数据不完整时返回空指针
+const unsigned char *skipRLEScanline(const unsigned char *p, const unsigned char *end, int width) {
+    p += 4;
+    for (int c = 0; c < 4; c++) {
+        for (int x = 0; x < width;) {
+            if (p >= end) return nullptr;
+            int code = *p++;
+            if (code > 128) {
+                code &= 127;
+                p++;
+            } else {
+                p += code;
+            }
+            if (code == 0 || x + code > width) return nullptr;
+            x += code;
+        }
+    }
+    return p <= end ? p : nullptr;
+}
+
+// 解码一行新格式 RLE 数据，四个分量分别游程编码
+void decodeRLEScanline(const unsigned char *p, int width, unsigned char *rgbe) {
+    p += 4;
+    for (int c = 0; c < 4; c++) {
+        for (int x = 0; x < width;) {
+            int code = *p++;
+            if (code > 128) {
+                code &= 127;
+                unsigned char value = *p++;
+                while (code--) rgbe[4 * x++ + c] = value;
+            } else {
+                while (code--) rgbe[4 * x++ + c] = *p++;
+            }
+        }
+    }
+}
+
+// 解码一行未压缩或旧格式 RLE 的数据：像素 (1, 1, 1, n) 表示重复前一像素 n 次，连续出现时 n 逐次左移 8 位
+// prev 为上一行的最后一个像素，行首即出现重复时使用
+const unsigned char *decodeFlatScanline(const unsigned char *p, const unsigned char *end, int width,
+                                        unsigned char *rgbe, const unsigned char *prev) {
+    int x = 0;
+    int shift = 0;
+    while (x < width) {
+        if (end - p < 4) return nullptr;
+        if (p[0] == 1 && p[1] == 1 && p[2] == 1) {
+            const unsigned char *src = x > 0 ? rgbe + 4 * (x - 1) : prev;
+            size_t count = (size_t) p[3] << shift;
+            if (src == nullptr || count > (size_t) (width - x)) return nullptr;
+            for (; count > 0; count--, x++) std::memcpy(rgbe + 4 * x, src, 4);
+            shift += 8;
+        } else {
+            std::memcpy(rgbe + 4 * x, p, 4);
+            x++;
+            shift = 0;
+        }
+        p += 4;
+    }
+    return p;
+}
+
+// 解码内存中的 Radiance HDR 文件，只支持 -Y H +X W 与 +Y H +X W 两种方向，结果按从上到下的行序存储
+// 数据不完整时其余像素为 0 并返回 false，res 仍为完整尺寸的图像
+bool DecodeRadianceHDR(const unsigned char *data, size_t size, HDRLoaderResult &res) {
+    res.width = 0;
+    res.height = 0;
+    res.cols = nullptr;
+
+    const unsigned char *p = data;
+    const unsigned char *end = data + size;
+    if (size < 10 || (std::memcmp(data, "#?RADIANCE", 10) != 0 && std::memcmp(data, "#?RGBE", 6) != 0)) {
+        std::cout << "ERROR::HDR::NOT_RADIANCE_FILE" << std::endl;
+        return false;
+    }
+
+    // 文件头各行以空行结束，其后为分辨率行
+    while (true) {
+        const unsigned char *eol = (const unsigned char *) std::memchr(p, '\n', end - p);
+        if (eol == nullptr) {
+            std::cout << "ERROR::HDR::MISSING_HEADER_END" << std::endl;
+            return false;
+        }
+        bool empty = eol == p;
+        p = eol + 1;
+        if (empty) break;
+    }
+
+    const unsigned char *eol = (const unsigned char *) std::memchr(p, '\n', end - p);
+    if (eol == nullptr || eol - p >= 64) {
+        std::cout << "ERROR::HDR::BAD_RESOLUTION" << std::endl;
+        return false;
+    }
+    char reso[64] = {0};
+    std::memcpy(reso, p, eol - p);
+    p = eol + 1;
+
+    int width = 0, height = 0;
+    bool flipY = false;
+    if (std::sscanf(reso, "-Y %d +X %d", &height, &width) != 2) {
+        if (std::sscanf(reso, "+Y %d +X %d", &height, &width) != 2) {
+            std::cout << "ERROR::HDR::UNSUPPORTED_ORIENTATION " << reso << std::endl;
+            return false;
+        }
+        flipY = true;
+    }
+    if (width <= 0 || height <= 0) {
+        std::cout << "ERROR::HDR::BAD_RESOLUTION " << reso << std::endl;
+        return false;
+    }
+
+    res.width = width;
+    res.height = height;
+    res.cols = new float[(size_t) width * height * 3];
+
+    // 扫描连续的新格式 RLE 行，记录各行起始位置
+    std::vector<const unsigned char *> rowStart;
+    rowStart.reserve(height);
+    while ((int) rowStart.size() < height && isRLEScanline(p, end, width)) {
+        const unsigned char *next = skipRLEScanline(p, end, width);
+        if (next == nullptr) break;
+        rowStart.push_back(p);
+        p = next;
+    }
+    int nParallel = rowStart.size();
+
+    auto outputRow = [&](int y) {
+        return res.cols + (size_t) (flipY ? height - 1 - y : y) * width * 3;
+    };
+
+    ParallelFor(0, nParallel, 16, [&](int rowBegin, int rowEnd) {
+        std::vector<unsigned char> rgbe((size_t) width * 4);
+        for (int y = rowBegin; y < rowEnd; y++) {
+            decodeRLEScanline(rowStart[y], width, rgbe.data());
+            convertRGBEScanline(rgbe.data(), width, outputRow(y));
+        }
+    });
+
+    // 其余的行（未压缩、旧格式 RLE 或混合编码）逐行串行解码
+    std::vector<unsigned char> rgbe((size_t) width * 4);
+    unsigned char prev[4];
+    bool hasPrev = false;
+    if (nParallel > 0) {
+        decodeRLEScanline(rowStart[nParallel - 1], width, rgbe.data());
+        std::memcpy(prev, &rgbe[4 * (width - 1)], 4);
+        hasPrev = true;
+    }
+    for (int y = nParallel; y < height; y++) {
+        if (isRLEScanline(p, end, width)) {
+            const unsigned char *next = skipRLEScanline(p, end, width);
+            if (next != nullptr) decodeRLEScanline(p, width, rgbe.data());
+            p = next;
+        } else {
+            p = decodeFlatScanline(p, end, width, rgbe.data(), hasPrev ? prev : nullptr);
+        }
+        if (p == nullptr) {
+            std::cout << "ERROR::HDR::TRUNCATED_SCANLINE " << y << " / " << height << std::endl;
+            for (; y < height; y++) std::memset(outputRow(y), 0, (size_t) width * 3 * sizeof(float));
+            return false;
+        }
+        convertRGBEScanline(rgbe.data(), width, outputRow(y));
+        std::memcpy(prev, &rgbe[4 * (width - 1)], 4);
+        hasPrev = true;
+    }
+    return true;
+}
+
+#endif //RADIANCE_HDR_H
@@ -39,34 +39,15 @@ Screen screen;
 // Screen FBO
 RenderBuffer screenBuffer;
 
-// Triangle Count
-int nTriangles;
+// Triangles, BVH Nodes and HDR Map
+SceneResources sceneResources;
 
-// Triangle Data
-std::vector<Triangle> triangles;
+// Background Scene Loading
+SceneLoader sceneLoader;
 
-// Triangle Texture Buffer Data
-GLuint trianglesTextureBuffer;
-
-std::vector<Triangle_encoded> *triangles_encoded_ptr;
-std::vector<BVHNode_encoded> *nodes_encoded_ptr;
-
-std::vector<BVHNode> *nodes_prt;
-
-int nNodes;
-
-// BVH Node Texture Buffer Data
-GLuint nodesTextureBuffer;
-
-// HDR Map Data
-GLuint hdrMap;
-GLuint hdrCache;
-HDRLoaderResult hdrRes;
-int hdrResolution;
-
-
-GLuint tbo0;
-GLuint tbo1;
+// Background Environment Switching
+SceneLoader envMapLoader;
+static char envMapPathInput[512] = "";
 
 // Compute Shader Output Image
 GLuint tex_output;
@@ -77,13 +58,34 @@ const char *fragmentShaderRayTracingPath    = "../../src/shaders/fragment_shader
 const char *fragmentShaderScreenPath        = "../../src/shaders/fragment_shader_screen.glsl";
 const char *fragmentShaderToneMapping       = "../../src/shaders/fragment_shader_tone_mapping.glsl";
 
+// Scene File Path, empty string uses the built-in scene
+const char *scenePath                       = "../../resources/scenes/loong.rtscene";
+
+// Geometry Stream Path (CPU traversal benchmark only)
+const char *geometryStreamPath              = "scene_geometry.rtgs";
+
 // Render Setting
 bool    show_demo_window                    = false;
 bool    enableMultiImportantSample          = true;
+int     envSamplingMethod                   = ENV_SAMPLING_CDF;     // ENV_SAMPLING_ALIAS: alias tables, ENV_SAMPLING_MIP: luminance mip pyramid; only the selected table is built
 bool    enableEnvMap                        = true;
 bool    enableToneMapping                   = true;
 bool    enableGammaCorrection               = true;
 bool    enableBSDF                          = true;
+bool    enableAsyncLoading                  = true;     // render the environment first, swap geometry in when loaded
+bool    enableMaterialEditing               = true;     // false: render-only, CPU scene data is released after upload
+bool    benchmarkGeometryStream             = false;    // CPU traversal benchmark pages triangle blocks from geometryStreamPath, rendering stays resident
+int     benchmarkStreamCacheMB              = 256;      // byte budget of the benchmark's block cache, shared by all shards
+bool    enableMeshLOD                       = false;    // trace a simplified LOD per object chosen from its projected size, reselected when the camera settles
+int     meshLODLevels                       = 4;        // each level keeps MESH_LOD_RATIO of the previous level's triangles
+float   lodTrianglesPerPixel                = 0.5f;     // coarsest LOD with at least this many triangles per projected pixel
+int     uploadSliceMB                       = 64;       // per-frame budget for uploading background-loaded geometry and environment maps
+int     envMapFormat                        = ENV_MAP_RGB32F;   // ENV_MAP_RGB16F / ENV_MAP_RGB9E5 store the environment in 6 / 4 bytes per pixel
+int     envSamplingResolution               = 0;        // width of the importance-sampling distribution, 0: same as the HDR map
+bool    enableSunExtraction                 = false;    // split the dominant sun into an analytic disk light at import time
+float   sunThreshold                        = 0.01f;    // sun region: pixels brighter than this fraction of the peak
+bool    enableProceduralSky                 = false;    // analytic Preetham sky when the HDR map is disabled, parameters in sceneResources.sky
+bool    skyDirty                            = true;     // sky parameters changed, rebuild its sampling table and rebind
 float   envIntensity                        = 1;
 float   envAngle                            = 0; //0.33;
 int     maxBounce                           = 8;
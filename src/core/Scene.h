@@ -5,6 +5,9 @@
 #ifndef SCENE_H
 #define SCENE_H
 
+#include <chrono>
+#include <memory>
+
 // Built-in Material
 Material plane;
 Material white;
@@ -27,27 +30,241 @@ GameObject go_panther;
 
 GameObject current_game_object;
 
+// Scene File
+SceneDescription sceneDescription;
+std::vector<GameObject> sceneObjects;   // 与 sceneDescription.objects 一一对应
+bool sceneFileLoaded = false;
+
+// Mesh LOD
+// LOD 选择使用的视点，由主线程在加载开始前从相机复制，加载线程只读取这份副本
+struct LODViewpoint {
+    vec3 position = vec3(0);
+    float halfH = 1.0f;             // 相机半视角的正切
+    float screenHeight = SCR_HEIGHT;
+};
+LODViewpoint lodViewpoint;
+
+// 每个物体的 LOD 选择，由加载线程写入，主线程在加载完成后用当前相机重新比较
+struct LODSelection {
+    vec3 lo, hi;                        // 原网格的 AABB
+    mat4 model;                         // 网格（归一化前）到世界空间的变换
+    std::vector<size_t> lodTriangles;   // 各级 LOD 的三角形数，不含原网格
+    int level;                          // 0 为原网格
+};
+std::vector<LODSelection> lodSelections;
+
+// 相机静止的帧数达到此值后才检查 LOD 选择
+#define LOD_RESELECT_SETTLE_FRAMES  16
+// 目标三角形数在当前级别的此倍数范围内时不重新加载，避免在两级之间反复切换
+#define LOD_RESELECT_HYSTERESIS     2.0
+
+// Environment Switching
+EnvMapData pendingEnvMap;               // 工作线程准备中的环境贴图
+std::string queuedEnvMapPath;           // 等待开始的切换请求
+
+// Background Upload
+// 分帧上传中的环境贴图：贴图和所选的采样表逐帧经 PBO 写入，金字塔较小，在替换时一次上传
+// env 的数据需保持有效直到替换完成；loader 为发布该数据的加载器，上传期间仍视为加载中
+struct EnvMapUpload {
+    EnvMapData *env = nullptr;
+    SceneLoader *loader = nullptr;
+    EnvTextureUpload map;
+    EnvTextureUpload table;
+    double milliseconds = 0;
+    int frames = 0;
+};
+
+EnvMapUpload envMapUpload;
+double geometryUploadMs = 0;            // 分帧上传几何在主线程中累计的耗时
+int geometryUploadFrames = 0;
+
 void InitMaterial();
 void InitMesh();
-void InitHdrEnvMap();
+void InitMeshFromDescription();
+bool LoadObjectTriangles(const std::string &path, Material material, mat4 trans, bool smoothNormal, TriangleIndex &triangleIndex);
+void InitSceneDescription();
+void CaptureLODViewpoint();
+void LoadSceneGeometry();
+void BuildSceneGeometry();
+void BuildSceneBVH();
+std::string GetHdrEnvMapPath();
+bool LoadHdrEnvMap(const std::string &path, bool extractSun, float threshold, int samplingMethod, EnvMapData &env);
+void UploadHdrEnvMap(EnvMapData &env);
+void BeginHdrEnvMapUpload(EnvMapData &env, SceneLoader *loader);
+bool StepHdrEnvMapUpload(size_t budget);
 void EncodedBVHandTriangles();
+void FinishSceneGeometry();
+void PrintSceneMemory();
 
+// 同步加载，返回时场景已上传到 GPU
 void InitScene() {
 
+    sceneResources.keepCPUData = enableMaterialEditing;
+
+    InitSceneDescription();
+    CaptureLODViewpoint();
+
+    BuildSceneGeometry();
+
+    // 只使用解析天空的场景没有环境贴图，不创建空纹理
+    if (LoadHdrEnvMap(GetHdrEnvMapPath(), enableSunExtraction, sunThreshold, envSamplingMethod, sceneResources.env))
+        UploadHdrEnvMap(sceneResources.env);
+
+    EncodedBVHandTriangles();
+
+    FinishSceneGeometry();
+}
+
+// 异步加载：窗口立即开始渲染，工作线程依次准备环境贴图和几何
+// 环境贴图先于几何发布，因此首先显示只有环境光的画面，几何就绪后由 UpdateSceneLoading 换入
+void StartSceneLoading() {
+
+    sceneResources.keepCPUData = enableMaterialEditing;
+
+    // 材质和相机会写入 GUI 使用的全局变量，在主线程中初始化
+    // 工作线程不读取 camera，LOD 选择使用此时复制的视点
+    InitSceneDescription();
+    CaptureLODViewpoint();
+
+    // GUI 可能在加载期间修改太阳分离和采样方式的设置，工作线程使用此时的副本
+    bool extractSun = enableSunExtraction;
+    float threshold = sunThreshold;
+    int samplingMethod = envSamplingMethod;
+    sceneLoader.Start([extractSun, threshold, samplingMethod]() {
+        sceneLoader.BeginStage("HDR environment");
+        if (LoadHdrEnvMap(GetHdrEnvMapPath(), extractSun, threshold, samplingMethod, sceneResources.env))
+            sceneLoader.Publish(SCENE_LOAD_ENVIRONMENT);
+
+        LoadSceneGeometry();
+    });
+}
+
+// 在工作线程中导入网格、构建 BVH，完成后发布几何
+// 编码不在工作线程中进行：主线程分帧上传时直接编码到映射的缓冲，不保留编码后的整份暂存副本
+void LoadSceneGeometry() {
+    sceneLoader.BeginStage("mesh import");
+    InitMesh();
+    PrintSceneMemory();
+
+    sceneLoader.BeginStage("BVH build");
+    BuildSceneBVH();
+    sceneLoader.Publish(SCENE_LOAD_GEOMETRY);
+}
+
+// 按当前相机重新选择 LOD 并在后台重建几何，期间继续渲染旧的几何，完成后由 UpdateSceneLoading 换入
+// 加载期间材质编辑被禁用，所选物体已编辑的材质经 current_material 保留
+void StartGeometryReloading() {
+    CaptureLODViewpoint();
+    sceneResources.triangles.clear();
+    sceneResources.nodes.clear();
+    lodSelections.clear();
+    sceneLoader.Start(LoadSceneGeometry);
+}
+
+// 每帧在主线程调用，分帧上传工作线程已准备好的数据，每项每帧不超过 uploadSliceMB
+// 上传期间继续渲染之前的资源，返回 true 表示 GPU 资源已替换，需要重新绑定并重新累积
+bool UpdateSceneLoading() {
+    unsigned int ready = sceneLoader.Poll();
+    size_t budget = (size_t) std::max(1, uploadSliceMB) << 20;
+    bool changed = false;
+
+    if (ready & SCENE_LOAD_ENVIRONMENT) {
+        BeginHdrEnvMapUpload(sceneResources.env, &sceneLoader);
+    }
+    if (envMapUpload.loader == &sceneLoader && StepHdrEnvMapUpload(budget)) changed = true;
+
+    if (ready & SCENE_LOAD_GEOMETRY) {
+        sceneLoader.Join();
+        sceneResources.BeginGeometryUpload();
+        sceneLoader.BeginUpload();
+        geometryUploadMs = 0;
+        geometryUploadFrames = 0;
+    }
+    if (sceneResources.IsUploadingGeometry()) {
+        auto uploadStart = std::chrono::high_resolution_clock::now();
+        bool done = sceneResources.StepGeometryUpload(budget);
+        geometryUploadMs += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - uploadStart).count();
+        geometryUploadFrames++;
+        if (done) {
+            sceneLoader.EndUpload();
+            sceneLoader.RecordStage("GPU upload (" + std::to_string(geometryUploadFrames) + " frames)", geometryUploadMs);
+            FinishSceneGeometry();
+            sceneLoader.PrintTimings();
+            changed = true;
+        }
+    }
+
+    return changed;
+}
+
+// 初始化内置材质并读取场景文件，场景文件不可用时使用内置场景
+void InitSceneDescription() {
     InitMaterial();
 
     current_material = tear_glass;
+
+    // 内置材质可以在场景文件中按名称引用
+    sceneDescription = SceneDescription();
+    sceneDescription.materials = {
+            {"plane",               plane},
+            {"white",               white},
+            {"jade",                jade},
+            {"golden",              golden},
+            {"copper",              copper},
+            {"glass",               glass},
+            {"brown_glass",         brown_glass},
+            {"tear_glass",          tear_glass},
+            {"tear_glass_emissive", tear_glass_emissive},
+    };
+    sceneFileLoaded = scenePath[0] != '\0' && LoadSceneFile(scenePath, sceneDescription);
+
+    if (sceneFileLoaded) {
+        if (sceneDescription.selected >= 0)
+            current_material = sceneDescription.materials.at(sceneDescription.objects[sceneDescription.selected].material);
+
+        envIntensity = sceneDescription.envIntensity;
+        envAngle = sceneDescription.envAngle;
+        enableSunExtraction = sceneDescription.envSun;
+        if (sceneDescription.hasCamera) {
+            camera.Position = sceneDescription.cameraPosition;
+            camera.Rotation = sceneDescription.cameraRotation;
+            if (sceneDescription.cameraZoom > 0) camera.Zoom = sceneDescription.cameraZoom;
+        }
+        if (sceneDescription.hasSky) {
+            PreethamSky &sky = sceneResources.sky;
+            sky.turbidity = sceneDescription.skyTurbidity;
+            sky.sunElevation = sceneDescription.skyElevation;
+            sky.sunAzimuth = sceneDescription.skyAzimuth;
+            sky.intensity = sceneDescription.skyIntensity;
+            enableProceduralSky = true;
+            enableEnvMap = false;
+            skyDirty = true;
+        }
+        std::cout << "Scene file loaded: " << scenePath << " (" << sceneDescription.objects.size() << " objects, "
+                  << sceneDescription.meshes.size() << " meshes)" << std::endl;
+    }
+
     SetGlobalMaterialProperty(current_material);
+}
 
-    InitMesh();
-    current_game_object = go_loong;
+// 几何上传之后：写入基准测试用的流式几何、释放 CPU 端副本
+void FinishSceneGeometry() {
+    if (sceneFileLoaded)
+        current_game_object = sceneDescription.selected >= 0 ? sceneObjects[sceneDescription.selected] : GameObject();
+    else
+        current_game_object = go_loong;
 
-    nTriangles = triangles.size();
-    std::cout << "Scene loading completed: " << nTriangles << " triangle faces in total" << std::endl;
+    if (benchmarkGeometryStream) {
+        sceneResources.OpenBenchmarkStream(geometryStreamPath, (size_t) benchmarkStreamCacheMB * 1024 * 1024);
+    }
 
-    InitHdrEnvMap();
+    sceneResources.ReleaseCPUData();
 
-    EncodedBVHandTriangles();
+    // 仅渲染模式下三角形已经生成，不再需要缓存的网格映射
+    if (!sceneResources.keepCPUData) {
+        size_t released = GetGeometryCache().Trim();
+        std::cout << "Render-only mode: released " << released << " cached meshes" << std::endl;
+    }
 }
 
 void InitMaterial() {
@@ -109,81 +326,461 @@ void InitMaterial() {
 }
 
 void InitMesh() {
+    if (sceneFileLoaded) {
+        InitMeshFromDescription();
+        return;
+    }
 
     go_floor.active = true;
     go_loong.active = true;
 
-    if(go_floor.active) {
-        Model floor("../../resources/objects/floor.obj");
-        getTriangle(floor.meshes, triangles, plane,
-                    getTransformMatrix(vec3(0), vec3(2.2, -2, 3), vec3(14, 7, 7)), false);
+    // 网格通过 .rtmesh 二进制缓存内存映射加载，首次加载时由源文件转换生成
+    // 经几何缓存加载，同一文件只映射一次
+    TriangleIndex triangleIndex {};
+    if (go_floor.active) {
+        LoadObjectTriangles("../../resources/objects/floor.obj", plane,
+                            getTransformMatrix(vec3(0), vec3(2.2, -2, 3), vec3(14, 7, 7)), false, triangleIndex);
     }
 
     if (go_bunny.active) {
-        Model bunny("../../resources/objects/bunny_4000.obj");   // 4000 face
-        getTriangle(bunny.meshes, triangles, current_material,
-                    getTransformMatrix(vec3(0), vec3(2.2, -2.5, 3), vec3(2)), false);
+        LoadObjectTriangles("../../resources/objects/bunny_4000.obj", current_material, // 4000 face
+                            getTransformMatrix(vec3(0), vec3(2.2, -2.5, 3), vec3(2)), false, triangleIndex);
     }
 
     if (go_sphere.active) {
-        Model sphere("../../resources/objects/sphere2.obj");
-        go_sphere.triangleIndex = getTriangle(sphere.meshes, triangles, current_material,
-                    getTransformMatrix(vec3(0, 90, 0), vec3(1.8, -1, 3), vec3(2)), true);
+        LoadObjectTriangles("../../resources/objects/sphere2.obj", current_material,
+                            getTransformMatrix(vec3(0, 90, 0), vec3(1.8, -1, 3), vec3(2)), true, go_sphere.triangleIndex);
     }
 
     if (go_loong.active) {
-        Model loong("../../resources/objects/loong.obj");        // 100000 face
-        go_loong.triangleIndex = getTriangle(loong.meshes, triangles, current_material,
-                                             getTransformMatrix(vec3(0), vec3(2, -2, 3), vec3(3.5)), true);
+        LoadObjectTriangles("../../resources/objects/loong.obj", current_material, // 100000 face
+                            getTransformMatrix(vec3(0), vec3(2, -2, 3), vec3(3.5)), true, go_loong.triangleIndex);
     }
 
     if (go_panther.active) {
-        Model panther("../../resources/objects/panther_100000.obj");     // 100000 face
-        go_panther.triangleIndex = getTriangle(panther.meshes, triangles, current_material,
-                    getTransformMatrix(vec3(0, -30, 0), vec3(0.8, -2.2, 5), vec3(4.5)), true);
+        LoadObjectTriangles("../../resources/objects/panther_100000.obj", current_material, // 100000 face
+                            getTransformMatrix(vec3(0, -30, 0), vec3(0.8, -2.2, 5), vec3(4.5)), true, go_panther.triangleIndex);
     }
 
     // Model teapot("../../resources/objects/renderman/teapot.obj");
-    // getTriangle(teapot.meshes, triangles, current_material,
+    // getTriangle(teapot.meshes, sceneResources.triangles, current_material,
     //             getTransformMatrix(vec3(0,0,0), vec3(2.6, -2.0, 3), vec3(2.5)), true);
 
     // camera.Rotation = glm::vec3(-90.0f, -14.0f, 0.0f);
     // Model dragon("../../resources/objects/dragon.obj");     // 831812 face
-    // getTriangle(dragon.meshes, triangles, current_material,
+    // getTriangle(dragon.meshes, sceneResources.triangles, current_material,
     //             getTransformMatrix(vec3(0, 130, 0), vec3(-0.2, -1.8, 3), vec3(3)), true);
 
     // Model boy_body("../../resources/objects/substance_boy/body.obj");
-    // getTriangle(boy_body.meshes, triangles, current_material,
+    // getTriangle(boy_body.meshes, sceneResources.triangles, current_material,
     //             getTransformMatrix(vec3(0, -85, 0), vec3(1.8, -1.25, 3.5), vec3(0.8)), true);
     //
     // Model boy_head("../../resources/objects/substance_boy/head.obj");
-    // getTriangle(boy_head.meshes, triangles, current_material,
+    // getTriangle(boy_head.meshes, sceneResources.triangles, current_material,
     //             getTransformMatrix(vec3(0, -85, 0), vec3(1.8, -0.33, 3.6), vec3(0.8)), true);
 }
 
-void InitHdrEnvMap() {
-    // HDR Environment Map
-    // -------------------
+// 按场景文件加载激活物体的网格
+// 网格经几何缓存加载，引用同一网格文件的多个物体共享映射的数据
+void InitMeshFromDescription() {
+    GeometryCache::Counters before = GetGeometryCache().GetCounters();
+
+    sceneObjects.assign(sceneDescription.objects.size(), GameObject());
+    int nActive = 0;
+    for (size_t i = 0; i < sceneDescription.objects.size(); i++) {
+        const SceneObjectDesc &object = sceneDescription.objects[i];
+        if (!object.active) continue;
+
+        // 所选物体使用 current_material，重新加载几何时保留 GUI 中的编辑
+        const Material &material = (int) i == sceneDescription.selected ? current_material
+                                                                         : sceneDescription.materials.at(object.material);
+        if (!LoadObjectTriangles(sceneDescription.meshes.at(object.mesh).path, material,
+                                 getTransformMatrix(object.rotate, object.translate, object.scale), object.smooth,
+                                 sceneObjects[i].triangleIndex))
+            continue;
+
+        sceneObjects[i].active = true;
+        nActive++;
+    }
+
+    GeometryCache::Counters after = GetGeometryCache().GetCounters();
+    std::cout << "Scene objects: " << nActive << " active, geometry cache " << after.hits - before.hits << " hits / "
+              << after.misses - before.misses << " misses" << std::endl;
+}
+
+// 当前相机的视点，屏幕高度取渲染缓冲的高度
+LODViewpoint GetCameraLODViewpoint() {
+    LODViewpoint viewpoint;
+    viewpoint.position = camera.Position;
+    viewpoint.halfH = camera.halfH;
+    viewpoint.screenHeight = height > 0 ? (float) (height * RENDER_SCALE) : (float) SCR_HEIGHT;
+    return viewpoint;
+}
+
+// 复制当前相机作为 LOD 选择的视点，需在主线程中、加载开始前调用
+void CaptureLODViewpoint() {
+    lodViewpoint = GetCameraLODViewpoint();
+}
+
+// 三角形数不少于 target 的最简一级，0 为原网格
+int SelectLODLevel(const std::vector<size_t> &lodTriangles, double target) {
+    int level = 0;
+    while (level < (int) lodTriangles.size() && lodTriangles[level] >= target) level++;
+    return level;
+}
+
+// 物体在 viewpoint 下的投影直径（像素）
+float GetLODPixels(const LODSelection &selection, const LODViewpoint &viewpoint) {
+    return GetProjectedDiameter(selection.lo, selection.hi, selection.model, viewpoint.position, viewpoint.halfH,
+                                viewpoint.screenHeight);
+}
+
+// 每帧在主线程调用：相机静止 LOD_RESELECT_SETTLE_FRAMES 帧后，按当前视点检查每个物体的 LOD，
+// 有物体的目标超出当前级别的滞回范围时在后台重新加载几何
+void UpdateMeshLOD() {
+    if (!enableMeshLOD || lodSelections.empty() || sceneLoader.IsLoading()) return;
+    if (camera.LoopNum < LOD_RESELECT_SETTLE_FRAMES && camera.LoopNum != maxIterations) return;
+
+    LODViewpoint viewpoint = GetCameraLODViewpoint();
+    for (const LODSelection &selection: lodSelections) {
+        double pixels = GetLODPixels(selection, viewpoint);
+        double target = pixels * pixels * lodTrianglesPerPixel;
+        if (selection.level < SelectLODLevel(selection.lodTriangles, target * LOD_RESELECT_HYSTERESIS) ||
+            selection.level > SelectLODLevel(selection.lodTriangles, target / LOD_RESELECT_HYSTERESIS)) {
+            std::cout << "Mesh LOD: camera moved, reselecting levels" << std::endl;
+            StartGeometryReloading();
+            return;
+        }
+    }
+}
+
+// 经几何缓存加载网格，转为三角形追加到 sceneResources.triangles
+// 开启 enableMeshLOD 时按物体包围球在 lodViewpoint 下的投影大小选择 LOD：
+// 取三角形数不少于 投影直径^2 * lodTrianglesPerPixel 的最简一级，BVH 随后建立在所选 LOD 上
+// 选择结果记入 lodSelections，相机移动后由 UpdateMeshLOD 重新选择并重建 BVH
+bool LoadObjectTriangles(const std::string &path, Material material, mat4 trans, bool smoothNormal, TriangleIndex &triangleIndex) {
+    std::shared_ptr<const MeshFile> mesh = GetGeometryCache().Load(path);
+    if (!mesh) return false;
+
+    std::vector<MeshView> views = mesh->Views();
+    vec3 lo, hi;
+    getMeshBounds(views, lo, hi);
+    float maxaxis = getNormalizationScale(views, lo, hi);
+
+    if (enableMeshLOD) {
+        // 与 getTriangle 相同的归一化
+        LODSelection selection;
+        selection.lo = lo;
+        selection.hi = hi;
+        selection.model = trans * glm::scale(mat4(1.0f), vec3(1.0f / maxaxis));
+        float pixels = GetLODPixels(selection, lodViewpoint);
+        double target = (double) pixels * pixels * lodTrianglesPerPixel;
+
+        std::vector<std::shared_ptr<const MeshLOD>> lods = GetGeometryCache().LoadLODs(path, meshLODLevels);
+        for (const auto &lod: lods) selection.lodTriangles.push_back(lod->TriangleCount());
+        selection.level = SelectLODLevel(selection.lodTriangles, target);
+        if (selection.level > 0) views.assign(1, lods[selection.level - 1]->View());
+        lodSelections.push_back(selection);
+
+        size_t n = 0;
+        for (const MeshView &view: views) n += view.indexCount / 3;
+        std::cout << "Mesh LOD " << selection.level << ": " << path << " (" << n << " triangles, "
+                  << (int) glm::min(pixels, 1e6f) << " px)" << std::endl;
+    }
+
+    triangleIndex = getTriangle(views, maxaxis, sceneResources.triangles, material, trans, smoothNormal);
+    return true;
+}
+
+// 网格导入后输出三角形数与峰值常驻内存
+void PrintSceneMemory() {
+    size_t nTriangles = sceneResources.triangles.size();
+    double peakMB = GetPeakResidentBytes() / 1048576.0;
+    double sceneMB = nTriangles * sizeof(Triangle) / 1048576.0;
+    std::cout << "Scene loading completed: " << nTriangles << " triangle faces in total, " << sceneMB << " MB, peak RSS "
+              << peakMB << " MB";
+    if (nTriangles > 0) std::cout << " (" << peakMB / (nTriangles / 1e6) << " MB per million triangles)";
+    std::cout << std::endl;
+}
 
+// 启动时加载的环境贴图，场景文件指定时使用场景文件中的路径
+// 场景文件只使用解析天空时返回空路径，不加载 HDR
+std::string GetHdrEnvMapPath() {
     const char *peppermint_powerplant_1k = "../../resources/textures/hdr/peppermint_powerplant_1k.hdr";
     const char *peppermint_powerplant_4k = "../../resources/textures/hdr/peppermint_powerplant_4k.hdr";
     const char *sunset_4k = "../../resources/textures/hdr/sunset_4k.hdr";
 
-    HDRLoader::load(peppermint_powerplant_4k, hdrRes);
+    if (sceneFileLoaded && !sceneDescription.environment.empty()) return sceneDescription.environment;
+    if (sceneFileLoaded && sceneDescription.hasSky) return "";
+    return peppermint_powerplant_4k;
+}
 
-    hdrMap = getTextureRGB32F(hdrRes.width, hdrRes.height);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, hdrRes.width, hdrRes.height, 0, GL_RGB, GL_FLOAT, hdrRes.cols);
+// 读取 HDR 并计算重要性采样缓存，写入 env，不调用 OpenGL，可在工作线程中执行
+// extractSun、threshold 为太阳分离的设置，samplingMethod 为采样方式，只构建该方式需要的采样表
+// 这些设置由调用方在主线程中复制，工作线程不读取 GUI 修改的全局变量
+// 文件无法读取或 path 为空时返回 false，env 为空
+bool LoadHdrEnvMap(const std::string &path, bool extractSun, float threshold, int samplingMethod, EnvMapData &env) {
+    // HDR Environment Map
+    // -------------------
+    env.Release();
+    if (path.empty()) return false;
+    env.path = path;
+    env.samplingMethod = samplingMethod;
+
+    // HDR 文件只映射一次，解码与磁盘缓存的键共用
+    HDRLoaderResult &hdrRes = env.hdrRes;
+    uint64_t sourceHash = 0;
+    uint64_t sourceSize = 0;
+    {
+        MappedFile source;
+        if (!source.Open(path)) {
+            std::cout << "ERROR::HDR::FILE_NOT_FOUND " << path << std::endl;
+            return false;
+        }
+        source.AdviseSequential();
+        if (!DecodeRadianceHDR(source.Data(), source.Size(), hdrRes)) {
+            std::cout << "ERROR::HDR::LOAD_FAILED " << path << std::endl;
+            if (hdrRes.cols == nullptr) return false;
+        }
+        sourceHash = HashFileContents(source.Data(), source.Size());
+        sourceSize = source.Size();
+    }
+
+    // 环境贴图按等距柱状投影解释，采样表的布局也依赖 2:1 的宽高比
+    if (hdrRes.width != 2 * hdrRes.height) {
+        std::cout << "ERROR::HDR::NOT_EQUIRECTANGULAR " << path << " (" << hdrRes.width << " x " << hdrRes.height
+                  << ", expected 2:1)" << std::endl;
+        env.Release();
+        return false;
+    }
+
+    // 太阳分离之后，显示和采样分布都使用去掉太阳的天空
+    if (extractSun) {
+        env.sun = ExtractHdrSun(hdrRes.cols, hdrRes.width, hdrRes.height, threshold);
+        if (env.sun.found)
+            std::cout << "HDR sun extracted: " << env.sun.powerFraction * 100.0f << "% of the power, "
+                      << glm::degrees(std::acos(env.sun.cosAngle)) << " deg radius" << std::endl;
+        else
+            std::cout << "HDR sun: no dominant sun found, keeping the full map" << std::endl;
+    }
 
     // HDR Important Sampling Cache
     // ----------------------------
-    std::cout << "HDR Map Important Sample Cache, HDR Resolution: " << hdrRes.width << " x " << hdrRes.height << std::endl;
-    float *cache = calculateHdrCache(hdrRes.cols, hdrRes.width, hdrRes.height);
-    hdrCache = getTextureRGB32F(hdrRes.width, hdrRes.height);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, hdrRes.width, hdrRes.height, 0, GL_RGB, GL_FLOAT, cache);
-    hdrResolution = hdrRes.width;
+    // 采样分布的分辨率与显示用的环境贴图无关，降采样后像素的概率覆盖更大的立体角，
+    // 着色器中 hdrResolution、hdrSampleHeight 取采样分布的宽高（envSamplingResolution 为奇数时高度不是宽度的一半），pdf 的换算随之修正
+    int sampleWidth = hdrRes.width;
+    int sampleHeight = hdrRes.height;
+    if (envSamplingResolution > 0 && envSamplingResolution < hdrRes.width) {
+        sampleWidth = envSamplingResolution;
+        sampleHeight = std::max(1, (int) ((int64_t) hdrRes.height * sampleWidth / hdrRes.width));
+    }
+    env.sampleWidth = sampleWidth;
+    env.sampleHeight = sampleHeight;
+
+    // CDF 缓存和别名表只构建所选的一种，以 HDR 文件内容的哈希查找该方式的磁盘缓存，命中时直接映射，跳过预计算
+    // 分离了太阳时采样分布来自剩余的天空，键中混入分离的参数
+    if (samplingMethod == ENV_SAMPLING_CDF || samplingMethod == ENV_SAMPLING_ALIAS) {
+        std::string cachePath = GetHdrCacheFilePath(path, samplingMethod);
+        HdrCacheFile &cacheFile = env.cacheFile;
+        if (env.sun.found) sourceHash = MixHdrCacheKey(sourceHash, threshold);
+
+        if (sourceSize > 0 && cacheFile.Open(cachePath, sourceHash, sourceSize, sampleWidth, sampleHeight, samplingMethod)) {
+            std::cout << "HDR Map Important Sample Cache loaded from " << cachePath << std::endl;
+        } else {
+            std::cout << "HDR Map Important Sample Cache, HDR Resolution: " << hdrRes.width << " x " << hdrRes.height
+                      << ", Sampling Resolution: " << sampleWidth << " x " << sampleHeight << std::endl;
+            float *sampleSource = hdrRes.cols;
+            if (sampleWidth != hdrRes.width)
+                sampleSource = DownsampleHdr(hdrRes.cols, hdrRes.width, hdrRes.height, sampleWidth, sampleHeight);
+            float *table;
+            if (samplingMethod == ENV_SAMPLING_CDF)
+                table = env.cacheData = calculateHdrCache(sampleSource, sampleWidth, sampleHeight);
+            else
+                table = env.aliasData = calculateHdrAliasTable(sampleSource, sampleWidth, sampleHeight);
+            if (sampleSource != hdrRes.cols) delete[] sampleSource;
+
+            if (sourceSize > 0 && !WriteHdrCacheFile(cachePath, sourceHash, sourceSize, sampleWidth, sampleHeight,
+                                                     samplingMethod, table))
+                std::cout << "ERROR::HDR_CACHE_FILE::WRITE_FAILED " << cachePath << std::endl;
+        }
+    }
+
+    // 亮度金字塔只在选用时构建，不超过采样分布的分辨率，构建只需一次遍历，不写入磁盘缓存
+    if (samplingMethod == ENV_SAMPLING_MIP) env.pyramid.Build(hdrRes.cols, hdrRes.width, hdrRes.height, sampleWidth);
+    return true;
 }
 
-void EncodedBVHandTriangles() {
+// 在主线程开始上传 env：只分配纹理存储，数据由 StepHdrEnvMapUpload 逐帧写入
+void BeginHdrEnvMapUpload(EnvMapData &env, SceneLoader *loader) {
+    auto start = std::chrono::high_resolution_clock::now();
+    envMapUpload.env = &env;
+    envMapUpload.loader = loader;
+    envMapUpload.map = EnvTextureUpload();
+    envMapUpload.table = EnvTextureUpload();
+    envMapUpload.map.Begin(env.hdrRes.cols, env.hdrRes.width, env.hdrRes.height, envMapFormat);
+
+    // 只上传所选采样方式的采样表，磁盘缓存命中时直接从映射的文件上传
+    if (env.samplingMethod == ENV_SAMPLING_CDF || env.samplingMethod == ENV_SAMPLING_ALIAS) {
+        int rows = GetHdrSamplingTableRows(env.samplingMethod, env.sampleHeight);
+        envMapUpload.table.Begin(env.samplingMethod == ENV_SAMPLING_CDF ? env.Cache() : env.Alias(), env.sampleWidth,
+                                 rows, ENV_MAP_RGB32F);
+    }
+    if (loader != nullptr) loader->BeginUpload();
+    envMapUpload.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    envMapUpload.frames = 0;
+}
+
+// 每帧在主线程调用，写入不超过 budget 字节；全部写完后替换当前的环境贴图并返回 true，调用方随后重新绑定
+// 新纹理全部创建后才删除旧纹理；env 的采样数据上传后释放，HDR 像素移入 sceneResources.env
+bool StepHdrEnvMapUpload(size_t budget) {
+    if (envMapUpload.env == nullptr) return false;
+    auto start = std::chrono::high_resolution_clock::now();
+    envMapUpload.frames++;
+    bool done = envMapUpload.map.Step(budget) && envMapUpload.table.Step(budget);
+    envMapUpload.milliseconds += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    if (!done) return false;
+
+    EnvMapData &env = *envMapUpload.env;
+    int sampleWidth = env.sampleWidth;
+    int sampleHeight = env.sampleHeight;
+    GLuint hdrCache = 0, hdrAlias = 0;
+    if (env.samplingMethod == ENV_SAMPLING_CDF) hdrCache = envMapUpload.table.Texture();
+    if (env.samplingMethod == ENV_SAMPLING_ALIAS) hdrAlias = envMapUpload.table.Texture();
+    size_t samplingBytes = envMapUpload.table.Bytes();
+
+    GLuint hdrMip = 0;
+    int hdrMipLevels = 0;
+    size_t pyramidBytes = 0;
+    if (env.samplingMethod == ENV_SAMPLING_MIP) {
+        LuminancePyramid &pyramid = env.pyramid;
+        hdrMip = CreateLuminancePyramidTexture(pyramid);
+        hdrMipLevels = pyramid.LevelCount();
+        pyramidBytes = pyramid.Bytes();
+    }
+
+    sceneResources.DeleteEnvTextures();
+    sceneResources.hdrMap = envMapUpload.map.Texture();
+    sceneResources.hdrCache = hdrCache;
+    sceneResources.hdrAlias = hdrAlias;
+    sceneResources.hdrMip = hdrMip;
+    sceneResources.hdrMipLevels = hdrMipLevels;
+    sceneResources.hdrResolution = sampleWidth;
+    sceneResources.hdrSampleHeight = sampleHeight;
+    sceneResources.envSamplingMethod = env.samplingMethod;
+
+    std::cout << "Environment VRAM: map " << envMapUpload.map.Bytes() / (1024 * 1024) << " MB, sampling "
+              << samplingBytes / (1024 * 1024) << " MB, mip pyramid " << pyramidBytes / (1024 * 1024) << " MB"
+              << std::endl;
+    env.ReleaseSampling();
+
+    EnvMapData &current = sceneResources.env;
+    if (&env != &current) {
+        current.Release();
+        current.path = env.path;
+        current.hdrRes = env.hdrRes;
+        current.sampleWidth = sampleWidth;
+        current.sampleHeight = sampleHeight;
+        current.samplingMethod = env.samplingMethod;
+        current.sun = env.sun;
+        env.hdrRes = HDRLoaderResult{0, 0, nullptr};
+        env.Release();
+        // 仅渲染模式下不保留 HDR 像素
+        if (!sceneResources.keepCPUData) {
+            delete[] current.hdrRes.cols;
+            current.hdrRes.cols = nullptr;
+        }
+    }
+
+    if (envMapUpload.loader != nullptr) {
+        envMapUpload.loader->RecordStage("GPU upload (" + std::to_string(envMapUpload.frames) + " frames)",
+                                         envMapUpload.milliseconds);
+        envMapUpload.loader->EndUpload();
+    }
+    envMapUpload = EnvMapUpload();
+    return true;
+}
+
+// 在主线程一次上传 env 并替换当前的环境贴图，用于同步加载
+void UploadHdrEnvMap(EnvMapData &env) {
+    BeginHdrEnvMapUpload(env, nullptr);
+    StepHdrEnvMapUpload(SIZE_MAX);
+}
+
+// 运行时切换环境贴图
+// 工作线程读取 HDR 并构建采样数据，期间继续用旧的环境贴图渲染；数据就绪后由 UpdateEnvMapSwitch 在主线程上传并替换纹理
+// 切换进行中再次请求时只保留最后一次请求，当前切换完成后开始
+void RequestEnvMapSwitch(const std::string &path) {
+    queuedEnvMapPath = path;
+}
+
+// 当前环境贴图的路径，用于以新的导入设置重新加载
+// 启动加载期间 sceneResources.env 由工作线程写入，此时取场景的环境贴图路径
+std::string GetCurrentEnvMapPath() {
+    return sceneLoader.IsLoading() ? GetHdrEnvMapPath() : sceneResources.env.path;
+}
+
+// 每帧在主线程调用，返回 true 表示环境贴图已替换，需要重新绑定并重新累积
+// 场景加载完成之前不开始切换，避免与启动时的环境贴图加载同时写入；场景没有环境贴图（只使用解析天空）时同样可以切换
+bool UpdateEnvMapSwitch() {
+    bool swapped = false;
+    if (envMapLoader.Poll() & SCENE_LOAD_ENVIRONMENT) {
+        envMapLoader.Join();
+        BeginHdrEnvMapUpload(pendingEnvMap, &envMapLoader);
+    }
+    if (envMapUpload.loader == &envMapLoader && StepHdrEnvMapUpload((size_t) std::max(1, uploadSliceMB) << 20)) {
+        envMapLoader.PrintTimings();
+        std::cout << "Environment switched to " << sceneResources.env.path << std::endl;
+        swapped = true;
+    }
+
+    if (!queuedEnvMapPath.empty() && !envMapLoader.IsLoading() && !sceneLoader.IsLoading()) {
+        std::string path = queuedEnvMapPath;
+        queuedEnvMapPath.clear();
+        bool extractSun = enableSunExtraction;
+        float threshold = sunThreshold;
+        int samplingMethod = envSamplingMethod;
+        envMapLoader.Start([path, extractSun, threshold, samplingMethod]() {
+            envMapLoader.BeginStage("HDR environment");
+            if (LoadHdrEnvMap(path, extractSun, threshold, samplingMethod, pendingEnvMap))
+                envMapLoader.Publish(SCENE_LOAD_ENVIRONMENT);
+        });
+    }
+    return swapped;
+}
+
+// 每帧在主线程调用，天空参数变化后重新计算系数并替换采样表，返回 true 表示需要重新绑定并重新累积
+// 采样表只有 PREETHAM_SKY_WIDTH x PREETHAM_SKY_HEIGHT，拖动滑条时逐帧重建
+bool UpdateProceduralSky() {
+    if (!skyDirty) return false;
+    skyDirty = false;
+
+    PreethamSky &sky = sceneResources.sky;
+    auto start = std::chrono::high_resolution_clock::now();
+    sky.Update();
+    glDeleteTextures(1, &sceneResources.skyAlias);
+    sceneResources.skyAlias = CreateEnvMapTexture(sky.aliasTable.data(), PREETHAM_SKY_WIDTH, PREETHAM_SKY_HEIGHT + 1,
+                                                  ENV_MAP_RGB32F);
+    auto time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start);
+    if (enableProceduralSky)
+        std::cout << "Procedural sky updated in " << time.count() << " ms, sun " << sky.sun.powerFraction * 100.0f
+                  << "% of the power" << std::endl;
+    return true;
+}
+
+// 加载网格并构建 BVH，只生成 CPU 端数据，不调用 OpenGL
+// 可以在没有 GL 上下文的工具或无头渲染节点中使用，调用前需先 InitSceneDescription 和 CaptureLODViewpoint
+void BuildSceneGeometry() {
+    InitMesh();
+
+    PrintSceneMemory();
+
+    BuildSceneBVH();
+}
+
+void BuildSceneBVH() {
+    std::vector<Triangle> &triangles = sceneResources.triangles;
+    std::vector<BVHNode> &nodes = sceneResources.nodes;
+
     // Build BVH Node Data
     // -------------------
     BVHNode bvhTestNode;
@@ -192,68 +789,20 @@ void EncodedBVHandTriangles() {
     bvhTestNode.n = 30;
     bvhTestNode.AA = vec3(1, 1, 0);
     bvhTestNode.BB = vec3(0, 1, 0);
-    std::vector<BVHNode> nodes{bvhTestNode};
+    nodes.assign(1, bvhTestNode);
     // buildBVH(triangles, nodes, 0, triangles.size() - 1, 8);
-    buildBVHwithSAH(triangles, nodes, 0, triangles.size() - 1, 8);
-
-    nodes_prt = &nodes;
-    nNodes = nodes.size();
-    std::cout << "BVH building completed: " << nNodes << " nodes in total" << std::endl;
-
-    // Encode BVHNode and AABB
-    // -----------------------
-    std::vector<BVHNode_encoded> nodes_encoded(nNodes);
-    nodes_encoded_ptr = &nodes_encoded;
-    for (int i = 0; i < nNodes; i++) {
-        nodes_encoded[i].childs = vec3(nodes[i].left, nodes[i].right, 0);
-        nodes_encoded[i].leafInfo = vec3(nodes[i].n, nodes[i].index, 0);
-        nodes_encoded[i].AA = nodes[i].AA;
-        nodes_encoded[i].BB = nodes[i].BB;
-    }
+    buildBVHwithSAH(triangles, nodes, 8);
 
-    // Encode Triangle Data
-    // --------------------
-    std::vector<Triangle_encoded> triangles_encoded(nTriangles);
-    triangles_encoded_ptr = &triangles_encoded;
-    for (int i = 0; i < nTriangles; i++) {
-        Triangle &t = triangles[i];
-        Material &m = t.material;
-        // vertex position
-        triangles_encoded[i].p1 = t.p1;
-        triangles_encoded[i].p2 = t.p2;
-        triangles_encoded[i].p3 = t.p3;
-        // vertex normal
-        triangles_encoded[i].n1 = t.n1;
-        triangles_encoded[i].n2 = t.n2;
-        triangles_encoded[i].n3 = t.n3;
-        // material
-        triangles_encoded[i].emissive = m.emissive;
-        triangles_encoded[i].baseColor = m.baseColor;
-        triangles_encoded[i].param1 = vec3(m.subsurface, m.metallic, m.specular);
-        triangles_encoded[i].param2 = vec3(m.specularTint, m.roughness, m.anisotropic);
-        triangles_encoded[i].param3 = vec3(m.sheen, m.sheenTint, m.clearcoat);
-        triangles_encoded[i].param4 = vec3(m.clearcoatGloss, m.IOR, m.transmission);
-        triangles_encoded[i].mediumColor = m.mediumColor;
-        triangles_encoded[i].param5 = vec3(m.mediumType, m.mediumDensity, m.mediumAnisotropy);
-    }
+    std::cout << "BVH building completed: " << nodes.size() << " nodes in total" << std::endl;
+}
 
-    // Triangle Texture Buffer
-    // -----------------------
-    glGenBuffers(1, &tbo0);
-    glBindBuffer(GL_TEXTURE_BUFFER, tbo0);
-    glBufferData(GL_TEXTURE_BUFFER, triangles_encoded_ptr->size() * sizeof(Triangle_encoded), &triangles_encoded[0], GL_STATIC_DRAW);
-    glGenTextures(1, &trianglesTextureBuffer);
-    glBindTexture(GL_TEXTURE_BUFFER, trianglesTextureBuffer);
-    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGB32F, tbo0);
-
-    // BVHNode Texture Buffer
-    // -----------------------
-    glGenBuffers(1, &tbo1);
-    glBindBuffer(GL_TEXTURE_BUFFER, tbo1);
-    glBufferData(GL_TEXTURE_BUFFER, nodes_encoded_ptr->size() * sizeof(BVHNode_encoded), &nodes_encoded[0], GL_STATIC_DRAW);
-    glGenTextures(1, &nodesTextureBuffer);
-    glBindTexture(GL_TEXTURE_BUFFER, nodesTextureBuffer);
-    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGB32F, tbo1);
+void EncodedBVHandTriangles() {
+    // Encode and Upload Triangles and BVHNodes
+    // ----------------------------------------
+    auto encodeStart = std::chrono::high_resolution_clock::now();
+    sceneResources.UploadGeometry();
+    auto encodeTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - encodeStart);
+    std::cout << "Triangle encoding completed: " << encodeTime.count() << " ms" << std::endl;
 }
 
 #endif //SCENE_H
@@ -0,0 +1,305 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include <glm/glm.hpp>
+
+#include "Material.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 文本场景描述 (.rtscene)
+// 每行一条语句，第一个词为类型，其后为 key value 对，# 之后为注释，含空格的路径用双引号括起
+//
+//   camera      position 0 0 7 rotation -87.78 -14 0 zoom 25
+//   environment path ../../resources/textures/hdr/peppermint_powerplant_1k.hdr intensity 1 angle 0 sun 0
+//   sky         turbidity 2.5 elevation 30 azimuth 0 intensity 0.05
+//   material    jade base white baseColor 0.55 0.78 0.55 specular 1 IOR 1.79 subsurface 1
+//   mesh        loong path ../../resources/objects/loong_100000.obj
+//   object      loong mesh loong material jade translate 2 -2 3 rotate 0 0 0 scale 3.5 3.5 3.5 smooth 1 select 1
+//
+// material 的 base 指定继承的材质（内置材质或之前声明的材质），其余 key 与 Material 的成员同名
+// environment 的 sun 为 1 时在导入时把太阳分离为解析的圆盘光源，见 EnvSun.h
+// sky 以解析的 Preetham 天空代替环境贴图（见 PreethamSky.h），同时没有 environment 语句时不加载 HDR
+// object 的 active 为 0 时不加载其网格；多个 object 引用同一网格文件时只加载一次
+// select 指定 GUI 中编辑材质的物体，只能选择激活的物体
+
+struct SceneMeshDesc {
+    std::string path;
+};
+
+struct SceneObjectDesc {
+    std::string name;
+    std::string mesh;
+    std::string material;
+    glm::vec3 rotate = glm::vec3(0);
+    glm::vec3 translate = glm::vec3(0);
+    glm::vec3 scale = glm::vec3(1);
+    bool smooth = false;
+    bool active = true;
+};
+
+struct SceneDescription {
+    std::unordered_map<std::string, Material> materials;
+    std::unordered_map<std::string, SceneMeshDesc> meshes;
+    std::vector<SceneObjectDesc> objects;
+    int selected = -1;              // GUI 中编辑的物体，-1 表示最后一个激活的物体
+
+    std::string environment;        // HDR 路径，为空时使用默认环境贴图
+    float envIntensity = 1;
+    float envAngle = 0;
+    bool envSun = false;            // 分离太阳与天空
+
+    bool hasSky = false;            // 使用 Preetham 天空
+    float skyTurbidity = 2.5f;
+    float skyElevation = 30.0f;     // 太阳高度角（度）
+    float skyAzimuth = 0.0f;        // 太阳方位角（度）
+    float skyIntensity = 0.05f;
+
+    bool hasCamera = false;
+    glm::vec3 cameraPosition = glm::vec3(0);
+    glm::vec3 cameraRotation = glm::vec3(0);
+    float cameraZoom = 0;           // 0 表示不修改
+};
+
+// 按空白切分一行，支持双引号和 # 注释
+std::vector<std::string> TokenizeSceneLine(const std::string &line) {
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && isspace((unsigned char) line[i])) i++;
+        if (i >= line.size() || line[i] == '#') break;
+        if (line[i] == '"') {
+            size_t end = line.find('"', i + 1);
+            if (end == std::string::npos) end = line.size();
+            tokens.push_back(line.substr(i + 1, end - i - 1));
+            i = end + 1;
+        } else {
+            size_t start = i;
+            while (i < line.size() && !isspace((unsigned char) line[i])) i++;
+            tokens.push_back(line.substr(start, i - start));
+        }
+    }
+    return tokens;
+}
+
+// 逐个读取 key 之后的参数
+class SceneLineReader {
+public:
+    SceneLineReader(const std::vector<std::string> &tokens, size_t first) : tokens(tokens), next(first) {}
+
+    bool Done() const { return next >= tokens.size(); }
+
+    bool Key(std::string &key) {
+        if (Done()) return false;
+        key = tokens[next++];
+        return true;
+    }
+
+    bool String(std::string &value) {
+        if (Done()) return false;
+        value = tokens[next++];
+        return true;
+    }
+
+    bool Float(float &value) {
+        if (Done()) return false;
+        char *end = nullptr;
+        value = std::strtof(tokens[next].c_str(), &end);
+        if (end == tokens[next].c_str() || *end != '\0') return false;
+        next++;
+        return true;
+    }
+
+    bool Bool(bool &value) {
+        float f;
+        if (!Float(f)) return false;
+        value = f != 0;
+        return true;
+    }
+
+    bool Vec3(glm::vec3 &value) {
+        return Float(value.x) && Float(value.y) && Float(value.z);
+    }
+
+private:
+    const std::vector<std::string> &tokens;
+    size_t next;
+};
+
+// 读取 Material 的一个属性
+bool ReadMaterialProperty(SceneLineReader &reader, const std::string &key, Material &m) {
+    if (key == "baseColor") return reader.Vec3(m.baseColor);
+    if (key == "emissive") return reader.Vec3(m.emissive);
+    if (key == "mediumColor") return reader.Vec3(m.mediumColor);
+
+    struct Property {
+        const char *name;
+        float Material::*member;
+    };
+    static const Property properties[] = {
+            {"subsurface",       &Material::subsurface},
+            {"metallic",         &Material::metallic},
+            {"specular",         &Material::specular},
+            {"specularTint",     &Material::specularTint},
+            {"roughness",        &Material::roughness},
+            {"anisotropic",      &Material::anisotropic},
+            {"sheen",            &Material::sheen},
+            {"sheenTint",        &Material::sheenTint},
+            {"clearcoat",        &Material::clearcoat},
+            {"clearcoatGloss",   &Material::clearcoatGloss},
+            {"IOR",              &Material::IOR},
+            {"transmission",     &Material::transmission},
+            {"mediumType",       &Material::mediumType},
+            {"mediumDensity",    &Material::mediumDensity},
+            {"mediumAnisotropy", &Material::mediumAnisotropy},
+    };
+    for (auto &p: properties) {
+        if (key == p.name) return reader.Float(m.*p.member);
+    }
+    return false;
+}
+
+bool parseSceneStatement(const std::vector<std::string> &tokens, SceneDescription &scene, std::string &error) {
+    const std::string &type = tokens[0];
+    std::string key;
+
+    if (type == "camera") {
+        SceneLineReader reader(tokens, 1);
+        scene.hasCamera = true;
+        bool ok = true;
+        while (ok && reader.Key(key)) {
+            ok = false;
+            if (key == "position") ok = reader.Vec3(scene.cameraPosition);
+            else if (key == "rotation") ok = reader.Vec3(scene.cameraRotation);
+            else if (key == "zoom") ok = reader.Float(scene.cameraZoom);
+        }
+        if (!ok) error = "invalid camera property " + key;
+    } else if (type == "environment") {
+        SceneLineReader reader(tokens, 1);
+        bool ok = true;
+        while (ok && reader.Key(key)) {
+            ok = false;
+            if (key == "path") ok = reader.String(scene.environment);
+            else if (key == "intensity") ok = reader.Float(scene.envIntensity);
+            else if (key == "angle") ok = reader.Float(scene.envAngle);
+            else if (key == "sun") ok = reader.Bool(scene.envSun);
+        }
+        if (!ok) error = "invalid environment property " + key;
+    } else if (type == "sky") {
+        SceneLineReader reader(tokens, 1);
+        scene.hasSky = true;
+        bool ok = true;
+        while (ok && reader.Key(key)) {
+            ok = false;
+            if (key == "turbidity") ok = reader.Float(scene.skyTurbidity);
+            else if (key == "elevation") ok = reader.Float(scene.skyElevation);
+            else if (key == "azimuth") ok = reader.Float(scene.skyAzimuth);
+            else if (key == "intensity") ok = reader.Float(scene.skyIntensity);
+        }
+        if (!ok) error = "invalid sky property " + key;
+    } else if (type == "material" || type == "mesh" || type == "object") {
+        if (tokens.size() < 2) {
+            error = type + " without a name";
+            return false;
+        }
+        const std::string &name = tokens[1];
+        SceneLineReader reader(tokens, 2);
+
+        if (type == "material") {
+            Material m;
+            bool ok = true;
+            while (ok && reader.Key(key)) {
+                if (key == "base") {
+                    std::string base;
+                    ok = reader.String(base);
+                    auto it = scene.materials.find(base);
+                    if (ok && it == scene.materials.end()) {
+                        error = "unknown base material " + base;
+                        return false;
+                    }
+                    if (ok) m = it->second;
+                } else {
+                    ok = ReadMaterialProperty(reader, key, m);
+                }
+            }
+            if (!ok) error = "invalid material property " + key;
+            else scene.materials[name] = m;
+        } else if (type == "mesh") {
+            SceneMeshDesc mesh;
+            bool ok = true;
+            while (ok && reader.Key(key)) {
+                ok = false;
+                if (key == "path") ok = reader.String(mesh.path);
+            }
+            if (!ok || mesh.path.empty()) error = "invalid mesh property " + key;
+            else scene.meshes[name] = mesh;
+        } else {
+            SceneObjectDesc object;
+            object.name = name;
+            bool select = false;
+            bool ok = true;
+            while (ok && reader.Key(key)) {
+                ok = false;
+                if (key == "mesh") ok = reader.String(object.mesh);
+                else if (key == "material") ok = reader.String(object.material);
+                else if (key == "rotate") ok = reader.Vec3(object.rotate);
+                else if (key == "translate") ok = reader.Vec3(object.translate);
+                else if (key == "scale") ok = reader.Vec3(object.scale);
+                else if (key == "smooth") ok = reader.Bool(object.smooth);
+                else if (key == "active") ok = reader.Bool(object.active);
+                else if (key == "select") ok = reader.Bool(select);
+            }
+            if (!ok) {
+                error = "invalid object property " + key;
+            } else if (scene.meshes.find(object.mesh) == scene.meshes.end()) {
+                error = "unknown mesh " + object.mesh;
+            } else if (scene.materials.find(object.material) == scene.materials.end()) {
+                error = "unknown material " + object.material;
+            } else if (select && !object.active) {
+                error = "cannot select inactive object " + name;
+            } else {
+                if (select) scene.selected = scene.objects.size();
+                scene.objects.push_back(object);
+            }
+        }
+    } else {
+        error = "unknown statement " + type;
+    }
+    return error.empty();
+}
+
+// 解析场景文件，scene.materials 中预先放入的材质可以被引用
+bool LoadSceneFile(const std::string &path, SceneDescription &scene) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cout << "ERROR::SCENE_FILE::NOT_FOUND " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::vector<std::string> tokens = TokenizeSceneLine(line);
+        if (tokens.empty()) continue;
+
+        std::string error;
+        if (!parseSceneStatement(tokens, scene, error)) {
+            std::cout << "ERROR::SCENE_FILE::" << path << ":" << lineNumber << " " << error << std::endl;
+            return false;
+        }
+    }
+
+    if (scene.selected < 0) {
+        for (int i = 0; i < (int) scene.objects.size(); i++)
+            if (scene.objects[i].active) scene.selected = i;
+    }
+    return true;
+}
+
+#endif //SCENE_FILE_H
@@ -0,0 +1,119 @@
+#ifndef SCENE_LOADER_H
+#define SCENE_LOADER_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 已准备好、等待主线程上传的数据
+#define SCENE_LOAD_ENVIRONMENT  1u
+#define SCENE_LOAD_GEOMETRY     2u
+
+// 后台场景加载
+// 加载任务在工作线程中按阶段执行，每个阶段计时
+// GL 上传只能在主线程进行：工作线程准备好一批数据后 Publish，主线程每帧 Poll 取走并上传
+// 大的数据分多帧上传，上传期间 BeginUpload / EndUpload 计数，仍视为加载中
+class SceneLoader {
+public:
+    struct StageTiming {
+        std::string name;
+        double milliseconds;
+    };
+
+    ~SceneLoader() { Join(); }
+
+    void Start(std::function<void()> job) {
+        Join();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            timings.clear();
+            stage.clear();
+        }
+        published = 0;
+        workerDone = false;
+        worker = std::thread([this, job]() {
+            job();
+            BeginStage("");
+            workerDone = true;
+        });
+    }
+
+    // 工作线程调用：结束上一阶段的计时并开始新阶段，name 为空时只结束计时
+    void BeginStage(const std::string &name) {
+        auto now = std::chrono::high_resolution_clock::now();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!stage.empty()) {
+            double ms = std::chrono::duration<double, std::milli>(now - stageStart).count();
+            timings.push_back(StageTiming{stage, ms});
+        }
+        stage = name;
+        stageStart = now;
+    }
+
+    // 主线程调用：记录在主线程完成的阶段
+    void RecordStage(const std::string &name, double milliseconds) {
+        std::lock_guard<std::mutex> lock(mutex);
+        timings.push_back(StageTiming{name, milliseconds});
+    }
+
+    // 工作线程调用：flags 对应的数据已经写好，可以上传
+    void Publish(unsigned int flags) {
+        published |= flags;
+    }
+
+    // 主线程调用：取走已发布的数据标记
+    unsigned int Poll() {
+        return published.exchange(0);
+    }
+
+    // 主线程调用：开始和结束一项分帧上传
+    void BeginUpload() {
+        uploads++;
+    }
+
+    void EndUpload() {
+        uploads--;
+    }
+
+    // 工作线程仍在运行，有已发布但未被主线程取走的数据，或有未完成的分帧上传
+    bool IsLoading() const {
+        return !workerDone || published != 0 || uploads > 0;
+    }
+
+    std::string CurrentStage() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stage.empty() && uploads > 0 ? "GPU upload" : stage;
+    }
+
+    void PrintTimings() {
+        std::lock_guard<std::mutex> lock(mutex);
+        double total = 0;
+        for (auto &t: timings) {
+            std::cout << "Scene loading stage " << t.name << ": " << t.milliseconds << " ms" << std::endl;
+            total += t.milliseconds;
+        }
+        std::cout << "Scene loading total: " << total << " ms" << std::endl;
+    }
+
+    void Join() {
+        if (worker.joinable()) worker.join();
+    }
+
+private:
+    std::thread worker;
+    std::atomic<unsigned int> published{0};
+    std::atomic<bool> workerDone{true};
+    int uploads = 0;    // 只在主线程访问
+
+    std::mutex mutex;
+    std::string stage;
+    std::chrono::high_resolution_clock::time_point stageStart;
+    std::vector<StageTiming> timings;
+};
+
+#endif //SCENE_LOADER_H
@@ -0,0 +1,262 @@
+#ifndef SCENE_RESOURCES_H
+#define SCENE_RESOURCES_H
+
+#include <glad/glad.h>
+
+#include "Triangle.h"
+#include "BVH.h"
+#include "CPUTracer.h"
+#include "GeometryStream.h"
+#include "HdrCacheFile.h"
+#include "EnvMipSampling.h"
+#include "EnvSun.h"
+#include "PreethamSky.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 环境贴图的 CPU 端数据：HDR 像素与重要性采样数据
+// 由 LoadHdrEnvMap 填写，不调用 OpenGL，可在工作线程中准备；UploadHdrEnvMap 在主线程上传后释放采样数据
+// 只准备 samplingMethod 需要的采样表，其余为空
+struct EnvMapData {
+    std::string path;
+    HDRLoaderResult hdrRes{0, 0, nullptr};
+    int samplingMethod = ENV_SAMPLING_CDF;
+    float *cacheData = nullptr;         // 重要性采样缓存
+    float *aliasData = nullptr;         // 重要性采样别名表
+    LuminancePyramid pyramid;           // 亮度 mip 金字塔，仅 ENV_SAMPLING_MIP 时构建
+    HdrCacheFile cacheFile;             // 命中磁盘缓存时映射的采样表，代替 cacheData 或 aliasData
+    int sampleWidth = 0;                // 采样分布（hdrCache、别名表）的分辨率，可低于 HDR 贴图
+    int sampleHeight = 0;
+    EnvSun sun;                         // 分离出的太阳，未分离时 found 为 false
+
+    const float *Cache() const { return cacheFile.Method() == ENV_SAMPLING_CDF ? cacheFile.Table() : cacheData; }
+
+    const float *Alias() const { return cacheFile.Method() == ENV_SAMPLING_ALIAS ? cacheFile.Table() : aliasData; }
+
+    // 释放采样数据，保留 HDR 像素
+    void ReleaseSampling() {
+        delete[] cacheData;
+        cacheData = nullptr;
+        delete[] aliasData;
+        aliasData = nullptr;
+        pyramid = LuminancePyramid();
+        cacheFile.Close();
+    }
+
+    void Release() {
+        ReleaseSampling();
+        delete[] hdrRes.cols;
+        hdrRes = HDRLoaderResult{0, 0, nullptr};
+        sampleWidth = 0;
+        sampleHeight = 0;
+        sun = EnvSun();
+        path.clear();
+    }
+};
+
+// 场景资源：持有三角形、BVH、HDR 的 CPU 端数据及对应的 GPU 缓冲
+// keepCPUData 为 false（仅渲染模式）时，上传完成后释放 CPU 端副本
+class SceneResources {
+public:
+    // CPU 端数据
+    std::vector<Triangle> triangles;
+    std::vector<BVHNode> nodes;
+    EnvMapData env;                     // 当前环境贴图，采样数据上传后释放
+    PreethamSky sky;                    // 解析天空的参数与低分辨率采样表
+
+    // CPU 遍历基准测试按块换入的三角形数据
+    GeometryStream geometryStream;
+
+    // GPU 端数据
+    GLuint trianglesBuffer = 0;
+    GLuint trianglesTexture = 0;
+    GLuint nodesBuffer = 0;
+    GLuint nodesTexture = 0;
+    GLuint hdrMap = 0;
+    GLuint hdrCache = 0;
+    GLuint hdrAlias = 0;
+    GLuint hdrMip = 0;
+    GLuint skyAlias = 0;
+
+    int nTriangles = 0;
+    int nNodes = 0;
+    int hdrResolution = 0;
+    int hdrSampleHeight = 0;    // 采样分布的高度，envSamplingResolution 为奇数时不等于 hdrResolution / 2
+    int hdrMipLevels = 0;
+    int envSamplingMethod = ENV_SAMPLING_CDF;   // 当前环境贴图已上传的采样表对应的采样方式
+
+    // 编辑模式下保留 CPU 端副本，用于修改材质
+    bool keepCPUData = true;
+
+    // 编码并上传三角形和 BVH 节点，一次写完
+    void UploadGeometry() {
+        BeginGeometryUpload();
+        StepGeometryUpload(SIZE_MAX);
+    }
+
+    // 分帧上传几何：分配新的缓冲，之后每帧由 StepGeometryUpload 写入一段
+    // 三角形在主线程编码后直接写入映射的缓冲，不需要整个场景大小的编码暂存数组
+    // 上传期间继续使用旧的缓冲渲染，全部写完后才替换
+    void BeginGeometryUpload() {
+        cancelGeometryUpload();
+        uploadTriangles = triangles.size();
+        uploadedTriangles = 0;
+        createTextureBuffer(uploadTrianglesBuffer, uploadTrianglesTexture, uploadTriangles * sizeof(Triangle_encoded),
+                            nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    // 编码并写入不超过 budget 字节的三角形（至少一个），三角形写完后写入 BVH 节点并替换旧的缓冲
+    // 返回 true 表示替换完成，调用方需重新绑定
+    bool StepGeometryUpload(size_t budget) {
+        if (uploadTrianglesBuffer == 0) return false;
+
+        size_t count = std::max<size_t>(1, budget / sizeof(Triangle_encoded));
+        int end = (int) std::min<size_t>(uploadTriangles, uploadedTriangles + count);
+        UploadTriangles(triangles, uploadTrianglesBuffer, uploadedTriangles, end);
+        uploadedTriangles = end;
+        if (uploadedTriangles < uploadTriangles) return false;
+
+        // BVHNode Texture Buffer
+        // ----------------------
+        DeleteGeometryBuffers();
+        trianglesBuffer = uploadTrianglesBuffer;
+        trianglesTexture = uploadTrianglesTexture;
+        uploadTrianglesBuffer = uploadTrianglesTexture = 0;
+        nTriangles = uploadTriangles;
+        nNodes = nodes.size();
+        createTextureBuffer(nodesBuffer, nodesTexture, nNodes * sizeof(BVHNode_encoded), nullptr, GL_STATIC_DRAW);
+        if (nNodes > 0) {
+            glBindBuffer(GL_TEXTURE_BUFFER, nodesBuffer);
+            auto *dst = (BVHNode_encoded *) glMapBufferRange(GL_TEXTURE_BUFFER, 0, nNodes * sizeof(BVHNode_encoded),
+                                                             GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (dst != nullptr) {
+                for (int i = 0; i < nNodes; i++) EncodeBVHNode(nodes[i], dst[i]);
+                glUnmapBuffer(GL_TEXTURE_BUFFER);
+            } else {
+                std::cout << "ERROR::SCENE_RESOURCES::MAP_BUFFER_FAILED" << std::endl;
+            }
+        }
+        return true;
+    }
+
+    // 分帧上传是否进行中
+    bool IsUploadingGeometry() const {
+        return uploadTrianglesBuffer != 0;
+    }
+
+    // 修改 [left, right) 区间三角形的材质，需要 CPU 端副本
+    void RefreshMaterial(TriangleIndex triangleIndex, Material m) {
+        if (triangles.empty()) return;
+        RefreshTriangleMaterial(triangleIndex, triangles, m, trianglesBuffer);
+    }
+
+    // 将三角形写入块文件，供 CPU 遍历基准测试按块换入
+    // 只是基准测试：BVH 构建和 GPU 渲染仍使用常驻的三角形数组，不会降低场景的内存占用
+    bool OpenBenchmarkStream(const std::string &path, size_t cacheBytes) {
+        geometryStream.Close();     // 重新加载几何时块文件会被重写
+        if (!WriteGeometryStream(path, triangles) || !geometryStream.Open(path, cacheBytes)) {
+            std::cout << "ERROR::SCENE_RESOURCES::GEOMETRY_STREAM_FAILED " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // 材质编辑需要常驻的三角形数组
+    bool Editable() const {
+        return !triangles.empty();
+    }
+
+    // 从相机发射主光线测试 CPU 遍历，打开了流式几何时从块文件读取三角形并输出缓存统计
+    void BenchmarkCPUTraversal(const Camera &cam, int width, int height) {
+        if (nodes.empty()) {
+            std::cout << "CPU traversal: BVH nodes have been released" << std::endl;
+            return;
+        }
+        if (geometryStream.IsOpen()) {
+            ::BenchmarkCPUTraversal(nodes, geometryStream, cam, width, height);
+            GeometryStream::Counters c = geometryStream.GetCounters();
+            std::cout << "Geometry stream: hit rate " << c.HitRate() * 100.0 << "%, " << c.misses << " misses, "
+                      << c.evictions << " evictions, " << c.bytesPaged / (1024 * 1024) << " MB paged" << std::endl;
+        } else if (!triangles.empty()) {
+            ResidentTriangles source(triangles);
+            ::BenchmarkCPUTraversal(nodes, source, cam, width, height);
+        }
+    }
+
+    // 上传完成后调用，仅渲染模式下释放 CPU 端副本
+    // 打开了流式几何时 BVH 节点供基准测试使用，不释放
+    void ReleaseCPUData() {
+        if (keepCPUData) return;
+
+        size_t bytes = triangles.capacity() * sizeof(Triangle);
+        std::vector<Triangle>().swap(triangles);
+        if (!geometryStream.IsOpen()) {
+            bytes += nodes.capacity() * sizeof(BVHNode);
+            std::vector<BVHNode>().swap(nodes);
+        }
+        if (env.hdrRes.cols != nullptr) {
+            bytes += (size_t) env.hdrRes.width * env.hdrRes.height * 3 * sizeof(float);
+            delete[] env.hdrRes.cols;
+            env.hdrRes.cols = nullptr;
+        }
+        std::cout << "Render-only mode: released " << bytes / (1024 * 1024) << " MB of CPU scene data" << std::endl;
+    }
+
+    // 删除环境贴图的纹理，切换环境贴图时先创建新纹理，再删除旧纹理
+    void DeleteEnvTextures() {
+        glDeleteTextures(1, &hdrMap);
+        glDeleteTextures(1, &hdrCache);
+        glDeleteTextures(1, &hdrAlias);
+        glDeleteTextures(1, &hdrMip);
+        hdrMap = hdrCache = hdrAlias = hdrMip = 0;
+    }
+
+    void DeleteGeometryBuffers() {
+        glDeleteTextures(1, &trianglesTexture);
+        glDeleteTextures(1, &nodesTexture);
+        glDeleteBuffers(1, &trianglesBuffer);
+        glDeleteBuffers(1, &nodesBuffer);
+        trianglesTexture = nodesTexture = trianglesBuffer = nodesBuffer = 0;
+    }
+
+    void Delete() {
+        cancelGeometryUpload();
+        DeleteGeometryBuffers();
+        DeleteEnvTextures();
+        glDeleteTextures(1, &skyAlias);
+        skyAlias = 0;
+
+        env.Release();
+
+        geometryStream.Close();
+    }
+
+private:
+    // 分帧上传中的三角形缓冲，替换前不被绑定
+    GLuint uploadTrianglesBuffer = 0;
+    GLuint uploadTrianglesTexture = 0;
+    int uploadTriangles = 0;
+    int uploadedTriangles = 0;
+
+    void cancelGeometryUpload() {
+        glDeleteTextures(1, &uploadTrianglesTexture);
+        glDeleteBuffers(1, &uploadTrianglesBuffer);
+        uploadTrianglesBuffer = uploadTrianglesTexture = 0;
+    }
+
+    // 创建 texture buffer 及对应的纹理，data 为空时只分配存储
+    static void createTextureBuffer(GLuint &buffer, GLuint &texture, size_t bytes, const void *data, GLenum usage) {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+        glBufferData(GL_TEXTURE_BUFFER, bytes, data, usage);
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGB32F, buffer);
+    }
+};
+
+#endif //SCENE_RESOURCES_H
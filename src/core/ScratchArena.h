@@ -0,0 +1,111 @@
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// 线性（bump）分配器，用于构建过程中的临时数组
+// 内存按块申请，Reset 回退到 Mark 位置后可复用，块在 Release 前不会归还系统
+class ScratchArena {
+public:
+    // 分配位置，用于 Reset 回退
+    struct Marker {
+        size_t block;
+        size_t offset;
+    };
+
+    // 统计信息
+    size_t allocations = 0;     // Allocate 调用次数
+    size_t heapAllocations = 0; // 向系统申请内存块的次数
+    size_t usedBytes = 0;       // 当前占用
+    size_t peakBytes = 0;       // 峰值占用
+
+    // 预先申请 bytes 大小的首块内存，需在没有未释放的分配时调用
+    void Reserve(size_t bytes) {
+        if (!blocks.empty() && blocks[0].size >= bytes) return;
+        Release();
+        addBlock(bytes);
+    }
+
+    template<typename T>
+    T *Allocate(size_t count) {
+        size_t bytes = (count * sizeof(T) + alignment - 1) & ~(alignment - 1);
+        allocations++;
+
+        // 当前块剩余空间不足时，使用下一块或新申请一块
+        while (current < blocks.size() && blocks[current].size - offset < bytes) {
+            base += blocks[current].size;
+            current++;
+            offset = 0;
+        }
+        if (current == blocks.size()) {
+            size_t size = blockSize;
+            if (bytes > size) size = bytes;
+            addBlock(size);
+        }
+
+        T *ptr = reinterpret_cast<T *>(blocks[current].data.get() + offset);
+        offset += bytes;
+        usedBytes = base + offset;
+        if (usedBytes > peakBytes) peakBytes = usedBytes;
+        return ptr;
+    }
+
+    Marker Mark() const {
+        return Marker{current, offset};
+    }
+
+    // 回退到 marker，之后分配的内存全部失效
+    void Reset(Marker marker) {
+        base = 0;
+        for (size_t i = 0; i < marker.block; i++) base += blocks[i].size;
+        current = marker.block;
+        offset = marker.offset;
+        usedBytes = base + offset;
+    }
+
+    void ResetStatistics() {
+        allocations = heapAllocations = 0;
+        peakBytes = usedBytes;
+    }
+
+    void Release() {
+        blocks.clear();
+        current = offset = base = 0;
+        usedBytes = 0;
+    }
+
+    size_t Capacity() const {
+        size_t bytes = 0;
+        for (auto &block: blocks) bytes += block.size;
+        return bytes;
+    }
+
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+
+    static const size_t alignment = 16;
+    static const size_t blockSize = 1 << 20;
+
+    std::vector<Block> blocks;
+    size_t current = 0;     // 当前块
+    size_t offset = 0;      // 当前块内的偏移
+    size_t base = 0;        // 当前块之前所有块的大小之和
+
+    void addBlock(size_t bytes) {
+        blocks.push_back(Block{std::unique_ptr<unsigned char[]>(new unsigned char[bytes]), bytes});
+        heapAllocations++;
+    }
+};
+
+// 每个线程独立的临时内存
+ScratchArena &GetThreadScratchArena() {
+    static thread_local ScratchArena arena;
+    return arena;
+}
+
+#endif //SCRATCH_ARENA_H
@@ -0,0 +1,221 @@
+#ifndef TEXTURE_POOL_H
+#define TEXTURE_POOL_H
+
+#include <glad/glad.h>
+
+#include "stb_image.h"
+
+#include "Parallel.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 异步纹理加载
+// Request 立即返回纹理名，纹理先以 1x1 白色占位；图片在工作线程中解码
+// 请求纹理的一方在主线程每帧调用 Update，通过 PBO 上传已解码的图片，每帧上传量受 budget 限制，不阻塞渲染循环
+// 光线追踪的材质不使用纹理，目前只有 Model（光栅化路径）会请求纹理，渲染循环不再每帧调用 Update
+class TexturePool {
+public:
+    struct Counters {
+        size_t requests = 0;
+        size_t hits = 0;        // 路径已请求过，直接返回
+        size_t uploaded = 0;
+        size_t failed = 0;
+    };
+
+    ~TexturePool() { stop(); }
+
+    // 请求加载 path，相同路径只加载一次
+    GLuint Request(const std::string &path) {
+        counters.requests++;
+        auto it = textures.find(path);
+        if (it != textures.end()) {
+            counters.hits++;
+            return it->second;
+        }
+
+        GLuint textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        const unsigned char white[4] = {255, 255, 255, 255};
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        textures[path] = textureID;
+
+        start();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(Job{path, textureID});
+        }
+        wake.notify_one();
+        return textureID;
+    }
+
+    // 主线程每帧调用，上传已解码的图片，单帧上传字节数不超过 budget（至少上传一张）
+    void Update(size_t budget = 32 * 1024 * 1024) {
+        size_t uploadedBytes = 0;
+        while (uploadedBytes < budget) {
+            Image image;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (decoded.empty()) break;
+                image = std::move(decoded.front());
+                decoded.pop_front();
+            }
+            if (image.pixels.empty()) {
+                counters.failed++;
+                std::cout << "Texture failed to load at path: " << image.path << std::endl;
+                continue;
+            }
+            upload(image);
+            uploadedBytes += image.pixels.size();
+            counters.uploaded++;
+        }
+    }
+
+    // 是否还有未完成的加载
+    bool Busy() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return !pending.empty() || !decoded.empty() || decoding > 0;
+    }
+
+    Counters GetCounters() const { return counters; }
+
+    // 需在 GL 上下文销毁前调用
+    void Delete() {
+        stop();
+        for (auto &texture: textures) glDeleteTextures(1, &texture.second);
+        textures.clear();
+        if (pbo != 0) glDeleteBuffers(1, &pbo);
+        pbo = 0;
+        pboSize = 0;
+    }
+
+private:
+    struct Job {
+        std::string path;
+        GLuint texture;
+    };
+
+    struct Image {
+        std::string path;
+        GLuint texture = 0;
+        int width = 0;
+        int height = 0;
+        int components = 0;
+        std::vector<unsigned char> pixels;
+    };
+
+    std::unordered_map<std::string, GLuint> textures;
+    Counters counters;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Job> pending;
+    std::deque<Image> decoded;
+    int decoding = 0;
+    bool stopping = false;
+
+    GLuint pbo = 0;
+    size_t pboSize = 0;
+
+    void start() {
+        if (!workers.empty()) return;
+        stopping = false;
+        unsigned int count = std::max(1u, std::min(GetWorkerCount(), 4u));
+        for (unsigned int i = 0; i < count; i++) workers.emplace_back([this]() { work(); });
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            pending.clear();
+        }
+        wake.notify_all();
+        for (auto &worker: workers) worker.join();
+        workers.clear();
+        decoded.clear();
+    }
+
+    void work() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]() { return stopping || !pending.empty(); });
+                if (stopping) return;
+                job = std::move(pending.front());
+                pending.pop_front();
+                decoding++;
+            }
+
+            Image image;
+            image.path = job.path;
+            image.texture = job.texture;
+            unsigned char *data = stbi_load(job.path.c_str(), &image.width, &image.height, &image.components, 0);
+            if (data) {
+                image.pixels.assign(data, data + (size_t) image.width * image.height * image.components);
+                stbi_image_free(data);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded.push_back(std::move(image));
+            decoding--;
+        }
+    }
+
+    // 经 PBO 上传，PBO 在多次上传之间复用，仅在容量不足时重新分配
+    void upload(const Image &image) {
+        GLenum format = GL_RGBA;
+        if (image.components == 1)
+            format = GL_RED;
+        else if (image.components == 2)
+            format = GL_RG;
+        else if (image.components == 3)
+            format = GL_RGB;
+
+        size_t bytes = image.pixels.size();
+        if (pbo == 0) glGenBuffers(1, &pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        if (bytes > pboSize) pboSize = bytes;
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, pboSize, nullptr, GL_STREAM_DRAW);     // 丢弃旧存储，避免等待上一次上传
+        void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (dst == nullptr) {
+            std::cout << "ERROR::TEXTURE_POOL::MAP_BUFFER_FAILED" << std::endl;
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            return;
+        }
+        std::memcpy(dst, image.pixels.data(), bytes);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        glBindTexture(GL_TEXTURE_2D, image.texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+};
+
+TexturePool &GetTexturePool() {
+    static TexturePool pool;
+    return pool;
+}
+
+#endif //TEXTURE_POOL_H
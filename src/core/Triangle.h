@@ -11,7 +11,15 @@
 #include "Mesh.h"
 #include "Shader.h"
 #include "Material.h"
+#include "Parallel.h"
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define TRIANGLE_SSE
+#endif
+
+#include <iostream>
+#include <mutex>
 #include <vector>
 
 struct TriangleIndex {
@@ -38,140 +46,216 @@ struct Triangle_encoded {
     glm::vec3 param5;        // offset:13 (mediumType, mediumDensity, mediumAnisotropy)
 };
 
-TriangleIndex getTriangle(std::vector<Mesh> &data, std::vector<Triangle> &triangles, Material material, mat4 trans, bool smoothNormal = false) {
-    // 顶点位置，索引
-    std::vector<vec3> vertices;
-    std::vector<vec3> normals;
-    std::vector<GLuint> indices;
-
-    // 计算 AABB 盒，归一化模型大小
-    float maxx = -11451419.19;
-    float maxy = -11451419.19;
-    float maxz = -11451419.19;
-    float minx = 11451419.19;
-    float miny = 11451419.19;
-    float minz = 11451419.19;
-
-    for (int i = 0; i < data.size(); ++i) {
-        for (int j = 0; j < data[i].vertices.size(); ++j) {
-            vertices.push_back(data[i].vertices[j].Position);
-            normals.push_back(data[i].vertices[j].Normal);
-            maxx = glm::max(maxx, data[i].vertices[j].Position.x);
-            maxy = glm::max(maxx, data[i].vertices[j].Position.y);
-            maxz = glm::max(maxx, data[i].vertices[j].Position.z);
-            minx = glm::min(minx, data[i].vertices[j].Position.x);
-            miny = glm::min(minx, data[i].vertices[j].Position.y);
-            minz = glm::min(minx, data[i].vertices[j].Position.z);
-           // std::cout << j << " Normal: " << data[i].vertices[j].Position.x << ", " << data[i].vertices[j].Position.y << ", "<< data[i].vertices[j].Position.z << std::endl;
-        }
-        for (int k = 0; k < data[i].indices.size(); ++k) {
-            indices.push_back(data[i].indices[k]);
-           // std::cout << k << " Position: " << data[i].indices[k] << std::endl;
-        }
+// 所有网格顶点的 AABB，分块并行求取后合并
+void getMeshBounds(const std::vector<MeshView> &data, vec3 &lo, vec3 &hi) {
+    lo = vec3(11451419.19f);
+    hi = vec3(-11451419.19f);
+    std::mutex mutex;
+    for (const MeshView &view: data) {
+        ParallelFor(0, view.vertexCount, 1 << 15, [&](int begin, int end) {
+            vec3 l = vec3(11451419.19f);
+            vec3 h = vec3(-11451419.19f);
+            for (int j = begin; j < end; j++) {
+                const vec3 &p = view.Position(j);
+                l = glm::min(l, p);
+                h = glm::max(h, p);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            lo = glm::min(lo, l);
+            hi = glm::max(hi, h);
+        });
     }
+}
+
+// 网格归一化使用的尺寸，由 AABB [lo, hi] 得到
+// 与原实现一致：y、z 的范围取 x 的极值与最后一个顶点的 y、z 中的较大（小）者，已有场景中模型的大小保持不变
+float getNormalizationScale(const std::vector<MeshView> &data, vec3 lo, vec3 hi) {
+    for (size_t i = data.size(); i-- > 0;) {
+        if (data[i].vertexCount == 0) continue;
+        const vec3 &last = data[i].Position(data[i].vertexCount - 1);
+        hi = vec3(hi.x, glm::max(hi.x, last.y), glm::max(hi.x, last.z));
+        lo = vec3(lo.x, glm::min(lo.x, last.y), glm::min(lo.x, last.z));
+        break;
+    }
+    vec3 len = hi - lo;
+    return glm::max(len.x, glm::max(len.y, len.z));
+}
 
-    // 模型大小归一化
-    float lenx = maxx - minx;
-    float leny = maxy - miny;
-    float lenz = maxz - minz;
-    float maxaxis = glm::max(lenx, glm::max(leny, lenz));
-    for (auto &v: vertices) {
-        v.x /= maxaxis;
-        v.y /= maxaxis;
-        v.z /= maxaxis;
+// 一个三角形三个顶点的仿射变换 m * (p, w)，结果依次写入 dst 起始的 9 个 float
+// SSE 下矩阵的四列常驻寄存器，三个顶点变换后拼成两次 4 分量写入和一次单分量写入
+// 两条路径的乘加顺序均与 glm 的 mat4 * vec4 相同
+struct TriangleTransform {
+#ifdef TRIANGLE_SSE
+    __m128 c0, c1, c2, c3;
+
+    explicit TriangleTransform(const mat4 &m, float w) {
+        c0 = _mm_setr_ps(m[0][0], m[0][1], m[0][2], 0.0f);
+        c1 = _mm_setr_ps(m[1][0], m[1][1], m[1][2], 0.0f);
+        c2 = _mm_setr_ps(m[2][0], m[2][1], m[2][2], 0.0f);
+        c3 = _mm_setr_ps(m[3][0] * w, m[3][1] * w, m[3][2] * w, 0.0f);
     }
 
-    // 通过矩阵进行坐标变换
-    for (auto &v: vertices) {
-        vec4 vv = vec4(v.x, v.y, v.z, 1);
-        vv = trans * vv;
-        v = vec3(vv.x, vv.y, vv.z);
+    __m128 Apply(const vec3 &p) const {
+        __m128 r = _mm_mul_ps(c0, _mm_set1_ps(p.x));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(p.y)));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(p.z)));
+        return _mm_add_ps(r, c3);
     }
 
-    for (auto &n : normals) {
-        vec4 nn = vec4(n.x, n.y, n.z, 0);
-        nn = trans * nn;
-        n = vec3(nn.x, nn.y, nn.z);
+    void Apply(const vec3 &a, const vec3 &b, const vec3 &c, float *dst) const {
+        __m128 ta = Apply(a);   // xa ya za -
+        __m128 tb = Apply(b);   // xb yb zb -
+        __m128 tc = Apply(c);   // xc yc zc -
+        __m128 t0 = _mm_shuffle_ps(tb, ta, _MM_SHUFFLE(2, 2, 0, 0));                   // xb xb za za
+        _mm_storeu_ps(dst, _mm_shuffle_ps(ta, t0, _MM_SHUFFLE(0, 2, 1, 0)));           // xa ya za xb
+        _mm_storeu_ps(dst + 4, _mm_shuffle_ps(tb, tc, _MM_SHUFFLE(1, 0, 2, 1)));       // yb zb xc yc
+        _mm_store_ss(dst + 8, _mm_shuffle_ps(tc, tc, _MM_SHUFFLE(2, 2, 2, 2)));        // zc
     }
+#else
+    mat3 linear;
+    vec3 offset;
+
+    explicit TriangleTransform(const mat4 &m, float w) : linear(m), offset(vec3(m[3]) * w) {}
 
-    // 构建 Triangle 对象数组
-    int offset = triangles.size();  // 增量更新
-    triangles.resize(offset + indices.size() / 3);
-    for (int i = 0; i < indices.size(); i += 3) {
-        Triangle &t = triangles[offset + i / 3];
-
-        // 传顶点属性
-        t.p1 = vertices[indices[i]];
-        t.p2 = vertices[indices[i + 1]];
-        t.p3 = vertices[indices[i + 2]];
-
-        // 传顶点法线
-        if (!smoothNormal) {
-            // 平直着色
-            vec3 n = normalize(cross(t.p2 - t.p1, t.p3 - t.p1));
-            t.n1 = n;
-            t.n2 = n;
-            t.n3 = n;
-        } else {
-            // 平滑着色
-            t.n1 = normalize(normals[indices[i]]);
-            t.n2 = normalize(normals[indices[i + 1]]);
-            t.n3 = normalize(normals[indices[i + 2]]);
+    void Apply(const vec3 &a, const vec3 &b, const vec3 &c, float *dst) const {
+        vec3 t[3] = {linear * a + offset, linear * b + offset, linear * c + offset};
+        for (int k = 0; k < 3; k++) {
+            dst[3 * k] = t[k].x;
+            dst[3 * k + 1] = t[k].y;
+            dst[3 * k + 2] = t[k].z;
         }
+    }
+#endif
+};
+
+static_assert(sizeof(vec3) == 3 * sizeof(float), "Triangle vertices are written as packed floats");
+
+// 将网格转为世界空间的三角形，追加到 triangles 末尾
+// 模型先按 maxaxis 归一化大小，再经 trans 变换，法线使用 trans 的逆转置矩阵
+// 归一化与 trans 预先合并为一个仿射变换，直接从网格数组读取，单趟并行写入预先分配好的输出
+// LOD 传入原网格的 maxaxis，使简化后的模型与原模型大小一致
+TriangleIndex getTriangle(const std::vector<MeshView> &data, float maxaxis, std::vector<Triangle> &triangles, Material material, mat4 trans, bool smoothNormal = false) {
+    // 归一化与模型变换合并：p' = trans * scale(1 / maxaxis) * p
+    TriangleTransform model(trans * glm::scale(mat4(1.0f), vec3(1.0f / maxaxis)), 1.0f);
+    TriangleTransform normalMatrix(mat4(transpose(inverse(mat3(trans)))), 0.0f);
+
+    // 预先分配输出
+    int first = triangles.size();  // 增量更新
+    size_t count = 0;
+    for (const MeshView &view: data) count += view.indexCount / 3;
+    triangles.resize(first + count);
+
+    int base = first;
+    for (const MeshView &view: data) {
+        int n = view.indexCount / 3;
+        ParallelFor(0, n, 4096, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                const unsigned int *index = view.indices + 3 * i;
+                Triangle &t = triangles[base + i];
 
-        // 传材质
-        t.material = material;
+                // 传顶点属性，p1、p2、p3 在 Triangle 中连续存放
+                model.Apply(view.Position(index[0]), view.Position(index[1]), view.Position(index[2]), &t.p1.x);
+
+                // 传顶点法线
+                if (!smoothNormal) {
+                    // 平直着色
+                    vec3 n = normalize(cross(t.p2 - t.p1, t.p3 - t.p1));
+                    t.n1 = n;
+                    t.n2 = n;
+                    t.n3 = n;
+                } else {
+                    // 平滑着色
+                    normalMatrix.Apply(view.Normal(index[0]), view.Normal(index[1]), view.Normal(index[2]), &t.n1.x);
+                    t.n1 = normalize(t.n1);
+                    t.n2 = normalize(t.n2);
+                    t.n3 = normalize(t.n3);
+                }
+
+                // 传材质
+                t.material = material;
+            }
+        });
+        base += n;
     }
 
     TriangleIndex triangleIndex {};
-    triangleIndex.left = offset;
+    triangleIndex.left = first;
     triangleIndex.right = triangles.size();
 
     return triangleIndex;
 }
 
-void RefreshTriangleMaterial(TriangleIndex triangleIndex, vector<Triangle> &triangles, vector<Triangle_encoded> &triangles_encoded, Material m, GLuint tbo, GLuint textureBuffer) {
-    int n = triangles.size();
-    for (int i = triangleIndex.left; i < triangleIndex.right-1; i++) {
-        Triangle &t = triangles[i];
-        t.material = m;
-        triangles_encoded[i].emissive = m.emissive;
-        triangles_encoded[i].baseColor = m.baseColor;
-        triangles_encoded[i].param1 = vec3(m.subsurface, m.metallic, m.specular);
-        triangles_encoded[i].param2 = vec3(m.specularTint, m.roughness, m.anisotropic);
-        triangles_encoded[i].param3 = vec3(m.sheen, m.sheenTint, m.clearcoat);
-        triangles_encoded[i].param4 = vec3(m.clearcoatGloss, m.IOR, m.transmission);
-        triangles_encoded[i].mediumColor = m.mediumColor;
-        triangles_encoded[i].param5 = vec3(m.mediumType, m.mediumDensity, m.mediumAnisotropy);
-    }
+// 按网格自身的大小归一化
+TriangleIndex getTriangle(const std::vector<MeshView> &data, std::vector<Triangle> &triangles, Material material, mat4 trans, bool smoothNormal = false) {
+    vec3 lo, hi;
+    getMeshBounds(data, lo, hi);
+    return getTriangle(data, getNormalizationScale(data, lo, hi), triangles, material, trans, smoothNormal);
+}
+
+// 将三角形打包为 GPU 纹理缓冲格式
+void EncodeTriangle(const Triangle &t, Triangle_encoded &e) {
+    const Material &m = t.material;
+    // vertex position
+    e.p1 = t.p1;
+    e.p2 = t.p2;
+    e.p3 = t.p3;
+    // vertex normal
+    e.n1 = t.n1;
+    e.n2 = t.n2;
+    e.n3 = t.n3;
+    // material
+    e.emissive = m.emissive;
+    e.baseColor = m.baseColor;
+    e.param1 = vec3(m.subsurface, m.metallic, m.specular);
+    e.param2 = vec3(m.specularTint, m.roughness, m.anisotropic);
+    e.param3 = vec3(m.sheen, m.sheenTint, m.clearcoat);
+    e.param4 = vec3(m.clearcoatGloss, m.IOR, m.transmission);
+    e.mediumColor = m.mediumColor;
+    e.param5 = vec3(m.mediumType, m.mediumDensity, m.mediumAnisotropy);
+}
+
+// 并行编码 [begin, end) 区间的三角形，dst[0] 对应 triangles[begin]
+void EncodeTriangles(const vector<Triangle> &triangles, Triangle_encoded *dst, int begin, int end) {
+    ParallelFor(begin, end, 4096, [&](int l, int r) {
+        for (int i = l; i < r; i++) {
+            EncodeTriangle(triangles[i], dst[i - begin]);
+        }
+    });
+}
+
+// 编码 [begin, end) 区间的三角形，直接写入 tbo 中映射的对应区域
+// tbo 需已分配 triangles.size() 个 Triangle_encoded 的空间
+void UploadTriangles(const vector<Triangle> &triangles, GLuint tbo, int begin, int end) {
+    if (begin >= end) return;
+
     glBindBuffer(GL_TEXTURE_BUFFER, tbo);
-    glBufferData(GL_TEXTURE_BUFFER, triangles_encoded.size() * sizeof(Triangle_encoded), &triangles_encoded[0], GL_STATIC_DRAW);
-    glBindTexture(GL_TEXTURE_BUFFER, textureBuffer);
-    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGB32F, tbo);
+    auto *dst = (Triangle_encoded *) glMapBufferRange(GL_TEXTURE_BUFFER,
+                                                      begin * sizeof(Triangle_encoded),
+                                                      (end - begin) * sizeof(Triangle_encoded),
+                                                      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (dst == nullptr) {
+        std::cout << "ERROR::TRIANGLE::MAP_BUFFER_FAILED" << std::endl;
+        return;
+    }
+    EncodeTriangles(triangles, dst, begin, end);
+    if (glUnmapBuffer(GL_TEXTURE_BUFFER) == GL_FALSE) {
+        std::cout << "ERROR::TRIANGLE::UNMAP_BUFFER_FAILED" << std::endl;
+    }
+}
+
+// 由常驻的 Mesh 生成三角形，转为 MeshView 后复用同一个转换
+TriangleIndex getTriangle(std::vector<Mesh> &data, std::vector<Triangle> &triangles, Material material, mat4 trans, bool smoothNormal = false) {
+    std::vector<MeshView> views;
+    for (auto &mesh: data) views.push_back(mesh.View());
+    return getTriangle(views, triangles, material, trans, smoothNormal);
 }
 
-void EncodeTriangle(vector<Triangle> &triangles, vector<Triangle_encoded> &triangles_encoded, int nTriangles) {
-    for (int i = 0; i < nTriangles; i++) {
-        Triangle &t = triangles[i];
-        Material &m = t.material;
-        // vertex position
-        triangles_encoded[i].p1 = t.p1;
-        triangles_encoded[i].p2 = t.p2;
-        triangles_encoded[i].p3 = t.p3;
-        // vertex normal
-        triangles_encoded[i].n1 = t.n1;
-        triangles_encoded[i].n2 = t.n2;
-        triangles_encoded[i].n3 = t.n3;
-        // material
-        triangles_encoded[i].emissive = m.emissive;
-        triangles_encoded[i].baseColor = m.baseColor;
-        triangles_encoded[i].param1 = vec3(m.subsurface, m.metallic, m.specular);
-        triangles_encoded[i].param2 = vec3(m.specularTint, m.roughness, m.anisotropic);
-        triangles_encoded[i].param3 = vec3(m.sheen, m.sheenTint, m.clearcoat);
-        triangles_encoded[i].param4 = vec3(m.clearcoatGloss, m.IOR, m.transmission);
-        triangles_encoded[i].mediumColor = m.mediumColor;
-        triangles_encoded[i].param5 = vec3(m.mediumType, m.mediumDensity, m.mediumAnisotropy);
+// 修改 [left, right) 区间三角形的材质，只重新上传这一区间
+void RefreshTriangleMaterial(TriangleIndex triangleIndex, vector<Triangle> &triangles, Material m, GLuint tbo) {
+    for (int i = triangleIndex.left; i < triangleIndex.right; i++) {
+        triangles[i].material = m;
     }
+    UploadTriangles(triangles, tbo, triangleIndex.left, triangleIndex.right);
 }
 
 #endif //TRIANGLE_H
@@ -17,6 +17,12 @@
 #define MEDIUM_SCATTER 2
 #define MEDIUM_EMISSIVE 3
 
+#define ENV_SAMPLING_CDF    0
+#define ENV_SAMPLING_ALIAS  1
+#define ENV_SAMPLING_MIP    2
+
+#define SKY_GROUND_ALBEDO   0.3     // 与 PREETHAM_GROUND_ALBEDO 一致
+
 // ============== struct ===============
 
 // triangle data
@@ -110,10 +116,14 @@ uniform Camera camera;
 uniform int screenWidth;
 uniform int screenHeight;
 uniform int hdrResolution;
+uniform int hdrSampleHeight;        // height of the sampling distribution, not necessarily hdrResolution / 2
 
 uniform sampler2D historyTexture;
 uniform sampler2D hdrMap;
 uniform sampler2D hdrCache;         // R:u, G:v, B:pdf(u, v)
+uniform sampler2D hdrAlias;         // R:q, G:alias, B:pdf(u, v); last row: marginal alias table of rows
+uniform sampler2D hdrMip;           // luminance mip pyramid, level 0 is the sampling resolution
+uniform int hdrMipLevels;
 
 uniform samplerBuffer triangles;    // triangle data
 uniform int nTriangles;
@@ -124,12 +134,30 @@ uniform int nNodes;
 uniform float randOrigin;
 
 uniform bool enableMultiImportantSample;
+uniform int envSamplingMethod;
 uniform bool enableEnvMap;
 uniform bool enableBSDF;
 
 uniform float envIntensity;
 uniform float envAngle;
 
+uniform bool enableSun;             // dominant sun split from the HDR into an analytic disk
+uniform vec3 sunDirection;          // disk center in map space (before envAngle rotation)
+uniform vec3 sunRadiance;
+uniform float sunCosAngle;
+uniform float sunSolidAngle;
+uniform float sunSampleProbability;
+
+uniform bool enableSky;             // analytic Preetham sky instead of the HDR map
+uniform sampler2D skyAlias;         // alias table of the sky on a low-resolution grid, same layout as hdrAlias
+uniform vec3 skyPerezA;             // Perez coefficients, components: Y, x, y
+uniform vec3 skyPerezB;
+uniform vec3 skyPerezC;
+uniform vec3 skyPerezD;
+uniform vec3 skyPerezE;
+uniform vec3 skyZenithScale;        // zenith Y, x, y divided by F(0, theta_s)
+uniform vec3 skySunDirection;       // map space
+
 uniform int maxBounce;
 uniform int maxIterations;
 
@@ -340,6 +368,9 @@ HitRecord hitBVH(Ray ray) {
     rec.isHit       = false;
     rec.distance    = INF;
 
+    // 场景几何尚未加载完成
+    if(nNodes < 2) return rec;
+
     int stack[256];
     int sp = 0;
 
@@ -620,29 +651,134 @@ vec2 sobolVec2(int i, int b) {
 }
 
 
-// 将三维向量 v 转为 HDR map 的纹理坐标 uv
-// -----------------------------------
+// 环境贴图绕 y 轴旋转 envAngle 圈：世界空间方向转到贴图空间，及其逆变换
+// 采样、pdf 与颜色查询都经过同一个旋转，采样分布本身不需要重新计算
+// ---------------------------------------------------------------
+vec3 envToMap(vec3 v) {
+    float a = TWO_PI * envAngle;
+    float c = cos(a), s = sin(a);
+    return vec3(c * v.x - s * v.z, v.y, s * v.x + c * v.z);
+}
+
+vec3 envToWorld(vec3 v) {
+    float a = TWO_PI * envAngle;
+    float c = cos(a), s = sin(a);
+    return vec3(c * v.x + s * v.z, v.y, -s * v.x + c * v.z);
+}
+
+// 将三维向量 v 转为 HDR map 的纹理坐标 uv，u 始终在 [0, 1] 内
+// -----------------------------------------------------
 vec2 toSphericalCoord(vec3 v) {
-    vec2 uv = vec2(atan(v.z, v.x), asin(v.y));
+    v = envToMap(v);
+    vec2 uv = vec2(atan(v.z, v.x), asin(clamp(v.y, -1.0, 1.0)));
     uv /= vec2(2.0 * PI, PI);
     uv += 0.5;
     uv.y = 1.0 - uv.y;
-    return uv + vec2(envAngle, 0);
+    return uv;
+}
+
+// HDR 纹理坐标转世界空间方向，是 toSphericalCoord 的逆
+// ----------------------------------------------
+vec3 hdrUvToDirection(vec2 uv) {
+    float phi = 2.0 * PI * (uv.x - 0.5);        // [-pi ~ pi]
+    float theta = PI * (0.5 - uv.y);            // [-pi/2 ~ pi/2]
+    return envToWorld(vec3(cos(theta) * cos(phi), sin(theta), cos(theta) * sin(phi)));
+}
+
+// 别名表采样：xi_1 按行的边缘分布选行，xi_2 按该行的条件分布选列，各一次 texelFetch
+// 随机数的小数部分先用于别名判断，再重新缩放为像素内的抖动，样本在像素内均匀分布
+// HDR 的 hdrAlias 与天空的 skyAlias 布局相同
+// ------------------------------------------------------------------------
+vec3 SampleAliasTable(sampler2D table, float xi_1, float xi_2) {
+    ivec2 size = textureSize(table, 0);
+    int width = size.x;
+    int height = size.y - 1;
+
+    // 选行
+    float fy = xi_1 * float(height);
+    int i = min(int(fy), height - 1);
+    float ry = fy - float(i);
+    vec2 m = texelFetch(table, ivec2(i, height), 0).rg;
+    int row = i;
+    if (ry < m.r) {
+        ry = ry / m.r;
+    } else {
+        row = int(m.g);
+        ry = (ry - m.r) / max(1.0 - m.r, 1e-7);
+    }
+
+    // 选列
+    float fx = xi_2 * float(width);
+    int j = min(int(fx), width - 1);
+    float rx = fx - float(j);
+    vec2 c = texelFetch(table, ivec2(j, row), 0).rg;
+    int col = j;
+    if (rx < c.r) {
+        rx = rx / c.r;
+    } else {
+        col = int(c.g);
+        rx = (rx - c.r) / max(1.0 - c.r, 1e-7);
+    }
+
+    vec2 uv = (vec2(col, row) + clamp(vec2(rx, ry), 0.0, 1.0)) / vec2(width, height);
+    return hdrUvToDirection(uv);
+}
+
+// 按 a : b 的比例二选一，xi 缩放到所选区间后复用，返回 true 表示选中 b
+bool chooseMipChild(float a, float b, inout float xi) {
+    float sum = a + b;
+    float t = sum > 0.0 ? a / sum : 0.5;
+    if (xi < t) {
+        xi = xi / t;
+        return false;
+    }
+    xi = min((xi - t) / (1.0 - t), 0.99999994);
+    return true;
+}
+
+// 亮度 mip 金字塔的层次化采样：从 1x1 的顶层逐层向下，按子像素的亮度比例选择，xi_1 决定列，xi_2 决定行
+// 剩余的随机数作为第 0 层像素内的抖动
+// ------------------------------------------------------------------------
+vec3 SampleHdrMip(float xi_1, float xi_2) {
+    ivec2 p = ivec2(0);
+    for (int level = hdrMipLevels - 2; level >= 0; level--) {
+        ivec2 size = textureSize(hdrMip, level);
+        ivec2 parentSize = textureSize(hdrMip, level + 1);
+        bool splitX = size.x > parentSize.x;
+        bool splitY = size.y > parentSize.y;
+        p *= ivec2(splitX ? 2 : 1, splitY ? 2 : 1);
+
+        float l00 = texelFetch(hdrMip, p, level).r;
+        float l10 = splitX ? texelFetch(hdrMip, p + ivec2(1, 0), level).r : 0.0;
+        float l01 = splitY ? texelFetch(hdrMip, p + ivec2(0, 1), level).r : 0.0;
+        float l11 = splitX && splitY ? texelFetch(hdrMip, p + ivec2(1, 1), level).r : 0.0;
+        if (splitX && chooseMipChild(l00 + l01, l10 + l11, xi_1)) {
+            p.x++;
+            l00 = l10;
+            l01 = l11;
+        }
+        if (splitY && chooseMipChild(l00, l01, xi_2)) p.y++;
+    }
+
+    vec2 uv = (vec2(p) + vec2(xi_1, xi_2)) / vec2(textureSize(hdrMip, 0));
+    return hdrUvToDirection(uv);
 }
 
 // 采样预计算的 HDR cache
 // --------------------
 vec3 SampleHdr(float xi_1, float xi_2) {
-    vec2 xy = texture(hdrCache, vec2(xi_1, xi_2)).rg; // x, y
-    xy.y = 1.0 - xy.y; // flip y
-
-    // 获取角度
-    float phi = 2.0 * PI * (xy.x - 0.5);    // [-pi ~ pi]
-    float theta = PI * (xy.y - 0.5);        // [-pi/2 ~ pi/2]
-
-    // 出射方向：球坐标计算方向
-    vec3 L = vec3(cos(theta) * cos(phi), sin(theta), cos(theta) * sin(phi));
-    return L;
+    if (envSamplingMethod == ENV_SAMPLING_ALIAS) return SampleAliasTable(hdrAlias, xi_1, xi_2);
+    if (envSamplingMethod == ENV_SAMPLING_MIP) return SampleHdrMip(xi_1, xi_2);
+
+    // 缓存给出所选像素左上角的纹理坐标 (x / width, y / height)
+    // xi 在缓存纹素内的小数部分与所选纹素无关，用作像素内的抖动，样本在像素内均匀分布，与 hdrPdf 一致
+    ivec2 size = textureSize(hdrCache, 0);
+    vec2 cell = vec2(xi_1, xi_2) * vec2(size);
+    vec2 xy = texelFetch(hdrCache, clamp(ivec2(cell), ivec2(0), size - 1), 0).rg;
+    vec2 uv = xy + fract(cell) / vec2(size);
+
+    // 出射方向：球坐标计算贴图空间的方向，再旋转到世界空间
+    return hdrUvToDirection(uv);
 }
 
 // 半球均匀采样
@@ -1033,7 +1169,7 @@ vec3 DisneyEval(Material material, vec3 V, vec3 N, vec3 L, out float bsdfPdf)
     float fresnel = DisneyFresnel(material, eta, dot(L, H), dot(V, H));
     CalculateBSDFLobePdfs(material, eta, specCol, fresnel, diffuseWt, specReflectWt, specRefractWt, clearcoatWt);
 
-    float pdf;
+    float pdf = 0.0;
 
     // Diffuse
     if (diffuseWt > 0.0 && L.z > 0.0)
@@ -1169,22 +1305,121 @@ vec3 hdrColor(vec3 L) {
 }
 
 // 输入光线方向 L 获取 HDR 在该位置的概率密度
-// hdr 分辨率为 4096 x 2048 --> hdrResolution = 4096
-float hdrPdf(vec3 L, int hdrResolution) {
+// 采样分布为 4096 x 2048 --> hdrResolution = 4096, hdrSampleHeight = 2048，只读取当前采样方式的纹理
+float hdrPdf(vec3 L) {
     vec2 uv = toSphericalCoord(normalize(L));   // 方向向量转 uv 纹理坐标
 
-    float pdf = texture(hdrCache, uv).b;      // 采样概率密度
+    float pdf = 0.0;
+    float nPixels = float(hdrResolution * hdrSampleHeight);
+    if (envSamplingMethod == ENV_SAMPLING_CDF) {
+        pdf = texture(hdrCache, uv).b;          // 采样概率密度
+    } else if (envSamplingMethod == ENV_SAMPLING_ALIAS) {
+        // 别名表采样的离散概率，按像素精确读取
+        ivec2 size = textureSize(hdrAlias, 0) - ivec2(0, 1);
+        ivec2 texel = clamp(ivec2(vec2(fract(uv.x), uv.y) * vec2(size)), ivec2(0), size - 1);
+        pdf = texelFetch(hdrAlias, texel, 0).b;
+    } else if (envSamplingMethod == ENV_SAMPLING_MIP) {
+        // 金字塔第 0 层像素的亮度除以顶层的平均亮度，金字塔的分辨率可能低于采样分布
+        ivec2 size = textureSize(hdrMip, 0);
+        ivec2 texel = clamp(ivec2(vec2(fract(uv.x), uv.y) * vec2(size)), ivec2(0), size - 1);
+        float top = texelFetch(hdrMip, ivec2(0), hdrMipLevels - 1).r;
+        nPixels = float(size.x * size.y);
+        pdf = texelFetch(hdrMip, texel, 0).r / max(top * nPixels, 1e-20);
+    }
 
     // float theta = PI * (0.5 - uv.y);            // theta 范围 [-pi/2 ~ pi/2]
     float theta = PI * uv.y;
     float sin_theta = max(sin(theta), 1e-10);
 
     // 球坐标和图片积分域的转换系数
-    float p_convert = float(hdrResolution * hdrResolution / 2) / (TWO_PI * PI * sin_theta);
+    float p_convert = nPixels / (TWO_PI * PI * sin_theta);
 
     return pdf * p_convert;
 }
 
+// 太阳圆盘的辐亮度，L 为世界空间方向
+// ------------------------------------
+vec3 sunColor(vec3 L) {
+    if (!enableSun) return vec3(0);
+    return dot(envToMap(normalize(L)), sunDirection) >= sunCosAngle ? sunRadiance : vec3(0);
+}
+
+// 圆锥内均匀采样的立体角概率密度
+float sunPdf(vec3 L) {
+    if (!enableSun) return 0.0;
+    return dot(envToMap(normalize(L)), sunDirection) >= sunCosAngle ? 1.0 / sunSolidAngle : 0.0;
+}
+
+// 在太阳圆盘对应的圆锥内均匀采样，1 - cos(theta) 由立体角直接计算，避免 1 - sunCosAngle 的精度损失
+vec3 SampleSun(float xi_1, float xi_2) {
+    float oneMinusCos = xi_1 * sunSolidAngle / TWO_PI;
+    float cosTheta = 1.0 - oneMinusCos;
+    float sinTheta = sqrt(max(0.0, oneMinusCos * (2.0 - oneMinusCos)));
+    float phi = TWO_PI * xi_2;
+
+    vec3 tangent, bitangent;
+    getTangent(sunDirection, tangent, bitangent);
+    vec3 dir = sinTheta * cos(phi) * tangent + sinTheta * sin(phi) * bitangent + cosTheta * sunDirection;
+    return envToWorld(dir);
+}
+
+// Preetham 天空的 Perez 分布，cosTheta 为与天顶夹角的余弦，gamma 为与太阳的夹角
+vec3 skyPerez(float cosTheta, float gamma) {
+    return (1.0 + skyPerezA * exp(skyPerezB / cosTheta)) *
+           (1.0 + skyPerezC * exp(skyPerezD * gamma) + skyPerezE * cos(gamma) * cos(gamma));
+}
+
+// Preetham 天空的辐亮度，不含太阳圆盘，与 PreethamSky::Radiance 一致
+// 地平线以下取地平线的值乘以地面反照率
+// ------------------------------------------------------------
+vec3 skyRadiance(vec3 L) {
+    vec3 v = envToMap(normalize(L));
+    float cosTheta = max(v.y, 0.001);
+    float gamma = acos(clamp(dot(v, skySunDirection), -1.0, 1.0));
+    vec3 Yxy = skyZenithScale * skyPerez(cosTheta, gamma);
+
+    // xyY -> XYZ -> 线性 sRGB
+    float Y = Yxy.x;
+    float X = Yxy.y / max(Yxy.z, 1e-6) * Y;
+    float Z = (1.0 - Yxy.y - Yxy.z) / max(Yxy.z, 1e-6) * Y;
+    vec3 rgb = max(vec3( 3.2404542 * X - 1.5371385 * Y - 0.4985314 * Z,
+                        -0.9692660 * X + 1.8760108 * Y + 0.0415560 * Z,
+                         0.0556434 * X - 0.2040259 * Y + 1.0572252 * Z), vec3(0));
+    return v.y < 0.0 ? rgb * SKY_GROUND_ALBEDO : rgb;
+}
+
+// 天空采样表的立体角概率密度，与 hdrPdf 的别名表分支相同
+float skyPdf(vec3 L) {
+    vec2 uv = toSphericalCoord(normalize(L));
+    ivec2 size = textureSize(skyAlias, 0) - ivec2(0, 1);
+    ivec2 texel = clamp(ivec2(uv * vec2(size)), ivec2(0), size - 1);
+    float pdf = texelFetch(skyAlias, texel, 0).b;
+    float sin_theta = max(sin(PI * uv.y), 1e-10);
+    return pdf * float(size.x * size.y) / (TWO_PI * PI * sin_theta);
+}
+
+// 环境光：去掉太阳后的环境贴图加上太阳圆盘，作为一个光源参与 MIS
+// 采样时以 sunSampleProbability 选择太阳，pdf 为两者的混合；enableSky 时以 Preetham 天空代替环境贴图
+// -------------------------------------------------------
+vec3 envColor(vec3 L) {
+    return (enableSky ? skyRadiance(L) : hdrColor(L)) + sunColor(L);
+}
+
+float envPdf(vec3 L) {
+    float pdf = enableSky ? skyPdf(L) : hdrPdf(L);
+    if (!enableSun) return pdf;
+    return mix(pdf, sunPdf(L), sunSampleProbability);
+}
+
+vec3 SampleEnv(float xi_1, float xi_2) {
+    if (enableSun) {
+        if (xi_1 < sunSampleProbability) return SampleSun(xi_1 / sunSampleProbability, xi_2);
+        xi_1 = (xi_1 - sunSampleProbability) / (1.0 - sunSampleProbability);
+    }
+    if (enableSky) return SampleAliasTable(skyAlias, xi_1, xi_2);
+    return SampleHdr(xi_1, xi_2);
+}
+
 // Default Sky Color
 // -----------------
 vec3 getDefaultSkyColor(float y) {
@@ -1245,7 +1480,7 @@ vec3 EvalTransmittance(Ray r)
 //                transmittance = vec3(0.0, 1.0, 0.0);
 ////                transmittance *= hdrColor(r.direction);
 //            }
-            transmittance *= hdrColor(r.direction) * envIntensity;
+            transmittance *= envColor(r.direction) * envIntensity;
             break;
         }
 
@@ -1300,24 +1535,26 @@ vec3 shadingImportanceSampling_BRDF(HitRecord hit) {
         // Random Sample HDR Environment Map
         Ray hdrTestRay;
         hdrTestRay.origin       = hit.hitPoint;
-        hdrTestRay.direction    = SampleHdr(rand(), rand());
+        hdrTestRay.direction    = SampleEnv(rand(), rand());
 
         vec3 tangent, bitangent;
         getTangent(N, tangent, bitangent);
 
-        if(dot(N, hdrTestRay.direction) > 0.0) {
+        // 只在环境光启用时采样，pdf 为 0 的方向（如空的环境贴图）不贡献
+        if((enableEnvMap || enableSky) && dot(N, hdrTestRay.direction) > 0.0) {
             HitRecord hdrHit = hitBVH(hdrTestRay);
 
             if(!hdrHit.isHit) {
                 vec3 L = hdrTestRay.direction;
 
-                float   light_pdf   = hdrPdf(L, hdrResolution);
-                vec3    light_fr    = hdrColor(L) * envIntensity;
+                float   light_pdf   = envPdf(L);
+                vec3    light_fr    = envColor(L) * envIntensity;
 
                 float   disney_brdf_pdf;
                 vec3    disney_brdf_fr = BRDF_Evaluate(V, N, L, tangent, bitangent, hit.material, disney_brdf_pdf);
 
                 float mis_weight = misMixWeight(light_pdf, disney_brdf_pdf);
+                if (light_pdf > 0.0)
                 Lo += mis_weight * history * light_fr * disney_brdf_fr * abs(dot(N, L)) / light_pdf;
             }
         }
@@ -1344,9 +1581,9 @@ vec3 shadingImportanceSampling_BRDF(HitRecord hit) {
 
         if(!newHit.isHit) {
             vec3 skyColor = vec3(0);
-            if(enableEnvMap){
-                skyColor = hdrColor(L) * envIntensity;
-                float pdf_light = hdrPdf(L, hdrResolution);
+            if(enableEnvMap || enableSky){
+                skyColor = envColor(L) * envIntensity;
+                float pdf_light = envPdf(L);
 
                 float mis_weight = misMixWeight(pdf_brdf, pdf_light);   // f(a,b) = a^2 / (a^2 + b^2)
                 Lo += mis_weight * history * skyColor * f_r * abs(NdotL) / pdf_brdf;
@@ -1379,18 +1616,18 @@ vec3 shadingImportanceSampling_BSDF(HitRecord hit) {
         // Random Sample HDR Environment Map
         Ray hdrTestRay;
         hdrTestRay.origin       = hit.hitPoint;
-        hdrTestRay.direction    = SampleHdr(rand(), rand());
+        hdrTestRay.direction    = SampleEnv(rand(), rand());
 
-        // Surface
-        if(dot(N, hdrTestRay.direction) > 0.0) {
+        // Surface，只在环境光启用时采样，pdf 为 0 的方向不贡献
+        if((enableEnvMap || enableSky) && dot(N, hdrTestRay.direction) > 0.0) {
             HitRecord hdrHit = hitBVH(hdrTestRay);
 
             // Hit HDR Map
             if(!hdrHit.isHit) {
                 vec3 L = hdrTestRay.direction;
 
-                float   light_pdf   = hdrPdf(L, hdrResolution);
-                vec3    light_fr    = hdrColor(L) * envIntensity;
+                float   light_pdf   = envPdf(L);
+                vec3    light_fr    = envColor(L) * envIntensity;
 
                 float   disney_eval_pdf;
                 vec3    disney_eval_fr = DisneyEval(hit.material, V, N, L, disney_eval_pdf);
@@ -1401,6 +1638,7 @@ vec3 shadingImportanceSampling_BSDF(HitRecord hit) {
                     mis_weight = 1.0;
                 }
 
+                if (light_pdf > 0.0)
                 Lo += mis_weight * history * light_fr * disney_eval_fr / light_pdf;
             }
         }
@@ -1482,10 +1720,10 @@ vec3 shadingImportanceSampling_BSDF(HitRecord hit) {
         // Next Hit HDR Map
         if(!nextHit.isHit) {
             vec3 light_fr = vec3(0);
-            if(enableEnvMap) {
-                light_fr = hdrColor(L) * envIntensity;
+            if(enableEnvMap || enableSky) {
+                light_fr = envColor(L) * envIntensity;
 
-                float light_pdf = hdrPdf(L, hdrResolution);
+                float light_pdf = envPdf(L);
                 float mis_weight = misMixWeight(disney_eval_pdf, light_pdf);
 
                 if (!enableMultiImportantSample) {
@@ -1494,7 +1732,7 @@ vec3 shadingImportanceSampling_BSDF(HitRecord hit) {
 
                 if (!mediumSampled)
                 Lo += mis_weight * history * light_fr * disney_eval_fr / disney_eval_pdf;
-                else
+                else if (light_pdf > 0.0)
                 Lo += history * light_fr * disney_eval_fr / light_pdf;
 
             }
@@ -1530,8 +1768,8 @@ void main() {
         vec3 curColor = vec3(1);
 
         if(!firstHit.isHit) {
-            if(enableEnvMap) {
-                curColor = hdrColor(cameraRay.direction) * envIntensity;
+            if(enableEnvMap || enableSky) {
+                curColor = envColor(cameraRay.direction) * envIntensity;
             }
             else {
                 curColor = getDefaultSkyColor(cameraRay.direction.y);
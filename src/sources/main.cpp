@@ -23,17 +23,31 @@
 #include "Camera.h"
 #include "Shader.h"
 #include "Model.h"
+#include "MeshFile.h"
+#include "GeometryCache.h"
 #include "Screen.h"
 #include "Triangle.h"
 #include "BVH.h"
 #include "Utility.h"
+#include "EnvCdfCache.h"
+#include "EnvAliasTable.h"
 #include "GameObeject.h"
 
 #include "hdrloader.h"
+#include "RadianceHDR.h"
+#include "EnvMapFormat.h"
+#include "EnvMipSampling.h"
+#include "EnvSun.h"
+#include "PreethamSky.h"
+
+#include "SceneResources.h"
+#include "SceneLoader.h"
+#include "SceneFile.h"
 
 #include "RenderSettings.h"
 #include "Scene.h"
 
+#include <cstring>
 #include <iostream>
 
 using namespace glm;
@@ -42,7 +56,8 @@ void processInput(GLFWwindow *window);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void mouse_scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
-void OnGUI(vector<Triangle_encoded> &triangles_encoded, GLuint tbo0);
+void OnGUI();
+void BindSceneResources(Shader &shader);
 
 int main() {
 
@@ -110,7 +125,12 @@ int main() {
 
     // Init Scene
     // ----------
-    InitScene();
+    if (enableAsyncLoading)
+        StartSceneLoading();
+    else
+        InitScene();
+
+    std::strncpy(envMapPathInput, GetHdrEnvMapPath().c_str(), sizeof(envMapPathInput) - 1);
 
 #pragma endregion
 
@@ -130,29 +150,7 @@ int main() {
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init(glsl_version);
 
-    RayTracerShader.use();
-
-    RayTracerShader.setInt("nTriangles", nTriangles);
-    RayTracerShader.setInt("nNodes", nodes_prt->size());
-
-    RayTracerShader.setInt("hdrResolution", hdrResolution);
-    RayTracerShader.setInt("historyTexture", 0);
-
-    glActiveTexture(GL_TEXTURE0 + 1);
-    glBindTexture(GL_TEXTURE_BUFFER, trianglesTextureBuffer);
-    RayTracerShader.setInt("triangles", 1);
-
-    glActiveTexture(GL_TEXTURE0 + 2);
-    glBindTexture(GL_TEXTURE_BUFFER, nodesTextureBuffer);
-    RayTracerShader.setInt("nodes", 2);
-
-    glActiveTexture(GL_TEXTURE0 + 3);
-    glBindTexture(GL_TEXTURE_2D, hdrMap);
-    RayTracerShader.setInt("hdrMap", 3);
-
-    glActiveTexture(GL_TEXTURE0 + 4);
-    glBindTexture(GL_TEXTURE_2D, hdrCache);
-    RayTracerShader.setInt("hdrCache", 4);
+    BindSceneResources(RayTracerShader);
 
     camera.Refresh();
     for (int i = 0; i < 3; ++i) {
@@ -170,7 +168,24 @@ int main() {
 
         processInput(window);
 
-        OnGUI(*triangles_encoded_ptr, tbo0);
+        // 后台加载完成的数据在此上传，重新绑定后从头累积
+        if (UpdateSceneLoading()) {
+            BindSceneResources(RayTracerShader);
+            camera.LoopNum = 0;
+        }
+        // 相机静止后按新的视点重新选择 LOD，几何在后台重建
+        UpdateMeshLOD();
+        // 后台准备好的环境贴图在此替换
+        if (UpdateEnvMapSwitch()) {
+            BindSceneResources(RayTracerShader);
+            camera.LoopNum = 0;
+        }
+        // 天空参数变化后重建采样表
+        if (UpdateProceduralSky()) {
+            BindSceneResources(RayTracerShader);
+            camera.LoopNum = 0;
+        }
+        OnGUI();
 
         if (maxIterations == -1 || camera.LoopNum < maxIterations) { camera.LoopIncrease(); }
 
@@ -191,7 +206,9 @@ int main() {
             RayTracerShader.setInt("screenWidth", width);
             RayTracerShader.setInt("screenHeight", height);
             RayTracerShader.setBool("enableMultiImportantSample", enableMultiImportantSample);
+            RayTracerShader.setInt("envSamplingMethod", sceneResources.envSamplingMethod);
             RayTracerShader.setBool("enableEnvMap", enableEnvMap);
+            RayTracerShader.setBool("enableSky", !enableEnvMap && enableProceduralSky);
             RayTracerShader.setFloat("envIntensity", envIntensity);
             RayTracerShader.setFloat("envAngle", envAngle);
             RayTracerShader.setInt("maxBounce", maxBounce);
@@ -256,6 +273,12 @@ int main() {
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
+    sceneLoader.Join();
+    envMapLoader.Join();
+    pendingEnvMap.Release();
+    sceneResources.Delete();
+    GetTexturePool().Delete();
+
     glfwTerminate();
 
     screenBuffer.Delete();
@@ -264,6 +287,67 @@ int main() {
     return 0;
 }
 
+// 绑定场景的 texture buffer 和 HDR 贴图
+void BindSceneResources(Shader &shader) {
+    shader.use();
+
+    shader.setInt("nTriangles", sceneResources.nTriangles);
+    shader.setInt("nNodes", sceneResources.nNodes);
+
+    shader.setInt("hdrResolution", sceneResources.hdrResolution);
+    shader.setInt("hdrSampleHeight", sceneResources.hdrSampleHeight);
+    shader.setInt("historyTexture", 0);
+
+    glActiveTexture(GL_TEXTURE0 + 1);
+    glBindTexture(GL_TEXTURE_BUFFER, sceneResources.trianglesTexture);
+    shader.setInt("triangles", 1);
+
+    glActiveTexture(GL_TEXTURE0 + 2);
+    glBindTexture(GL_TEXTURE_BUFFER, sceneResources.nodesTexture);
+    shader.setInt("nodes", 2);
+
+    glActiveTexture(GL_TEXTURE0 + 3);
+    glBindTexture(GL_TEXTURE_2D, sceneResources.hdrMap);
+    shader.setInt("hdrMap", 3);
+
+    glActiveTexture(GL_TEXTURE0 + 4);
+    glBindTexture(GL_TEXTURE_2D, sceneResources.hdrCache);
+    shader.setInt("hdrCache", 4);
+
+    glActiveTexture(GL_TEXTURE0 + 5);
+    glBindTexture(GL_TEXTURE_2D, sceneResources.hdrAlias);
+    shader.setInt("hdrAlias", 5);
+
+    glActiveTexture(GL_TEXTURE0 + 6);
+    glBindTexture(GL_TEXTURE_2D, sceneResources.hdrMip);
+    shader.setInt("hdrMip", 6);
+    shader.setInt("hdrMipLevels", sceneResources.hdrMipLevels);
+
+    // 解析天空在着色器中逐方向求值，只绑定低分辨率的采样表
+    const PreethamSky &sky = sceneResources.sky;
+    glActiveTexture(GL_TEXTURE0 + 7);
+    glBindTexture(GL_TEXTURE_2D, sceneResources.skyAlias);
+    shader.setInt("skyAlias", 7);
+    shader.setVec3("skyPerezA", sky.perez[0]);
+    shader.setVec3("skyPerezB", sky.perez[1]);
+    shader.setVec3("skyPerezC", sky.perez[2]);
+    shader.setVec3("skyPerezD", sky.perez[3]);
+    shader.setVec3("skyPerezE", sky.perez[4]);
+    shader.setVec3("skyZenithScale", sky.zenithScale);
+    shader.setVec3("skySunDirection", sky.sunDirection);
+
+    bool useSky = !enableEnvMap && enableProceduralSky;
+    const EnvSun &sun = useSky ? sky.sun : sceneResources.env.sun;
+    shader.setBool("enableSun", sun.found);
+    shader.setVec3("sunDirection", sun.direction);
+    shader.setVec3("sunRadiance", sun.radiance);
+    shader.setFloat("sunCosAngle", sun.cosAngle);
+    shader.setFloat("sunSolidAngle", sun.solidAngle);
+    shader.setFloat("sunSampleProbability", sun.sampleProbability);
+
+    glActiveTexture(GL_TEXTURE0);
+}
+
 void processInput(GLFWwindow *window) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
@@ -322,11 +406,13 @@ void mouse_scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
 }
 
 void setDirty() {
-    RefreshTriangleMaterial(current_game_object.triangleIndex, triangles, *triangles_encoded_ptr, current_material, tbo0, trianglesTextureBuffer);
+    // 未加载的物体（网格加载失败或场景中没有物体）没有三角形区间
+    if (current_game_object.active)
+        sceneResources.RefreshMaterial(current_game_object.triangleIndex, current_material);
     camera.LoopNum = 0;
 }
 
-void OnGUI(vector<Triangle_encoded> &triangles_encoded, GLuint tbo0) {
+void OnGUI() {
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -343,8 +429,13 @@ void OnGUI(vector<Triangle_encoded> &triangles_encoded, GLuint tbo0) {
     ImGui::Begin("Inspector", nullptr, window_flags);
     ImGui::Text("RMB: rotate the camera");
     ImGui::Text("WASDQE: move the camera");
+    bool loading = sceneLoader.IsLoading();
+    if (loading) {
+        ImGui::Text("Loading scene: %s", sceneLoader.CurrentStage().c_str());
+    }
     ImGui::Separator();
     if (ImGui::Checkbox("Enable HDR EnvMap", &enableEnvMap)) {
+        skyDirty = true;    // 重新绑定 HDR 或天空的太阳
         camera.LoopNum = 0;
     }
     if (enableEnvMap) {
@@ -354,10 +445,42 @@ void OnGUI(vector<Triangle_encoded> &triangles_encoded, GLuint tbo0) {
         if (ImGui::SliderFloat("Env Angle", &envAngle, -1, 1)) {
             camera.LoopNum = 0;
         }
+        if (ImGui::Checkbox("Extract Sun", &enableSunExtraction)) {
+            RequestEnvMapSwitch(GetCurrentEnvMapPath());
+        }
+        ImGui::SameLine();
+        Helper("Reloads the map with its dominant sun split into an analytic disk light");
+        ImGui::InputText("Env Map", envMapPathInput, sizeof(envMapPathInput));
+        if (ImGui::Button("Load Env Map")) {
+            RequestEnvMapSwitch(envMapPathInput);
+        }
+        ImGui::SameLine();
+        Helper("Loads the HDR and builds its sampling data in the background, the current map keeps rendering until it is ready");
+        if (envMapLoader.IsLoading()) {
+            ImGui::Text("Loading environment: %s", envMapLoader.CurrentStage().c_str());
+        }
+    } else {
+        if (ImGui::Checkbox("Procedural Sky", &enableProceduralSky)) {
+            skyDirty = true;
+        }
+        ImGui::SameLine();
+        Helper("Analytic Preetham sky evaluated per ray, only a 128 x 64 sampling table is stored");
+        if (enableProceduralSky) {
+            PreethamSky &sky = sceneResources.sky;
+            if (ImGui::SliderFloat("Turbidity", &sky.turbidity, 1.7f, 10)) skyDirty = true;
+            if (ImGui::SliderFloat("Sun Elevation", &sky.sunElevation, 0, 90)) skyDirty = true;
+            if (ImGui::SliderFloat("Sun Azimuth", &sky.sunAzimuth, -180, 180)) skyDirty = true;
+            if (ImGui::SliderFloat("Sky Intensity", &sky.intensity, 0, 0.2f)) skyDirty = true;
+        }
     }
     if (ImGui::Checkbox("Enable Multi-Important Sampling", &enableMultiImportantSample)) {
         camera.LoopNum = 0;
     }
+    if (ImGui::Combo("Env Sampling", &envSamplingMethod, "CDF Cache\0Alias Table\0Mip Pyramid\0\0")) {
+        RequestEnvMapSwitch(GetCurrentEnvMapPath());
+    }
+    ImGui::SameLine();
+    Helper("Only the selected sampling table is kept in VRAM, switching rebuilds it for the current map in the background");
     if (ImGui::SliderInt("Max Bounce", &maxBounce, 1, MAX_BOUNCE)) {
         camera.LoopNum = 0;
     }
@@ -395,6 +518,7 @@ void OnGUI(vector<Triangle_encoded> &triangles_encoded, GLuint tbo0) {
     if (ImGui::Checkbox("Enable BSDF Properties", &enableBSDF)) {
         camera.LoopNum = 0;
     }
+    ImGui::BeginDisabled(loading || !sceneResources.Editable());
     if (ImGui::ColorEdit3("Base Color", baseColor)) {
         current_material.baseColor = vec3(baseColor[0], baseColor[1], baseColor[2]);
         setDirty();
@@ -471,6 +595,15 @@ void OnGUI(vector<Triangle_encoded> &triangles_encoded, GLuint tbo0) {
             setDirty();
         }
     }
+    ImGui::EndDisabled();
+
+    ImGui::BeginDisabled(loading);
+    if (ImGui::Button("Benchmark CPU Traversal")) {
+        sceneResources.BenchmarkCPUTraversal(camera, width / 4, height / 4);
+    }
+    ImGui::EndDisabled();
+    ImGui::SameLine();
+    Helper("Traces primary rays at 1/4 resolution on the CPU and prints the timing to the console");
 
     if (ImGui::Button("Save Image")) {
         SaveFrame("../../screenshot/screenshot_" + to_string(camera.LoopNum) + "_spp.png", width, height);
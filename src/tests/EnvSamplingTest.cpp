@@ -0,0 +1,102 @@
+//
+// CPU tests of the environment importance sampling tables, run with ctest
+//
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "EnvCdfCache.h"
+#include "EnvAliasTable.h"
+#include "EnvMipSampling.h"
+#include "EnvRotation.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// 合成的 2:1 环境贴图：随高度变亮的天空、一个很亮的太阳、地平线以下较暗，另有一列全黑的像素
+std::vector<float> MakeTestEnvironment(int width, int height) {
+    std::vector<float> hdr((size_t) width * height * 3);
+    for (int i = 0; i < height; i++) {
+        for (int j = 0; j < width; j++) {
+            float u = (j + 0.5f) / width, v = (i + 0.5f) / height;
+            float sky = v < 0.5f ? 0.5f + 1.5f * (0.5f - v) : 0.05f;
+            float du = u - 0.3f, dv = v - 0.2f;
+            float sun = 400.0f * std::exp(-(du * du + dv * dv) / 0.001f);
+            float *c = &hdr[3 * ((size_t) i * width + j)];
+            c[0] = sky * 0.6f + sun;
+            c[1] = sky * 0.8f + sun * 0.9f;
+            c[2] = sky + sun * 0.7f;
+            if (j == width / 2) c[0] = c[1] = c[2] = 0.0f;
+        }
+    }
+    return hdr;
+}
+
+// s 个样本的直方图与离散分布 p 的总变差距离的期望，每个像素的计数近似为正态分布：
+// E|n_k / s - p_k| = sqrt(2 p_k (1 - p_k) / (pi s))
+double ExpectedHistogramDistance(const float *table, size_t nPixels, size_t samples) {
+    double sum = 0.0;
+    for (size_t k = 0; k < nPixels; k++) {
+        double p = table[3 * k + 2];
+        sum += std::sqrt(2.0 * p * (1.0 - p) / (3.14159265358979 * samples));
+    }
+    return 0.5 * sum;
+}
+
+// 输出一项检查的结果，返回是否通过
+bool Check(const char *name, double value, double bound) {
+    bool passed = value <= bound;
+    std::cout << (passed ? "PASSED " : "FAILED ") << name << ": " << value << " (bound " << bound << ")" << std::endl;
+    return passed;
+}
+
+int main() {
+    // 金字塔要求 2 的幂，与 CDF 缓存、别名表使用相同的分辨率以便逐像素比较
+    const int width = 256, height = 128;
+    std::vector<float> hdr = MakeTestEnvironment(width, height);
+
+    float *cache = calculateHdrCache(hdr.data(), width, height);
+    float *alias = calculateHdrAliasTable(hdr.data(), width, height);
+    LuminancePyramid pyramid;
+    pyramid.Build(hdr.data(), width, height, width);
+
+    int failures = 0;
+
+    // 采样直方图与离散分布的总变差距离只有统计误差，不超过其期望的 1.2 倍
+    size_t nPixels = (size_t) width * height;
+    size_t samples = nPixels * 64;
+    double expectedDistance = ExpectedHistogramDistance(cache, nPixels, samples);
+
+    // 别名表：直方图对照其 B 通道，且 B 通道与 CDF 缓存的 pdf 一致
+    double aliasDistance = ValidateHdrAliasTable(alias, width, height, samples);
+    failures += !Check("alias table histogram distance", aliasDistance, 1.2 * expectedDistance);
+    double aliasPdfError = 0.0;
+    for (size_t k = 0; k < nPixels; k++) {
+        double expected = cache[3 * k + 2];
+        if (expected > 1e-3 / nPixels)
+            aliasPdfError = std::max(aliasPdfError, std::fabs(alias[3 * k + 2] - expected) / expected);
+    }
+    failures += !Check("alias table pdf error vs CDF cache", aliasPdfError, 1e-3);
+
+    // 金字塔：pdf 与 CDF 缓存的 pdf 一致，采样直方图对照缓存的 pdf
+    EnvSamplerComparison comparison = CompareEnvSamplers(pyramid, cache, alias, width, height);
+    failures += !Check("mip pyramid compared at the sampling resolution", comparison.compared ? 0 : 1, 0);
+    failures += !Check("mip pyramid pdf error vs CDF cache", comparison.maxPdfError, 1e-3);
+    failures += !Check("mip pyramid histogram distance", comparison.mipDistance, 1.2 * expectedDistance);
+
+    // 旋转：各个 envAngle 下立体角 pdf 的积分为 1，采样的像素经世界方向查回原像素；别名表与 CDF 缓存的 B 通道都检查
+    EnvRotationValidation aliasRotation = ValidateEnvRotation(alias, alias, width, height);
+    failures += !Check("rotated alias pdf integral deviation", aliasRotation.maxIntegralError, 1e-2);
+    failures += !Check("rotated sample round-trip mismatches", aliasRotation.mismatches, 0);
+    EnvRotationValidation cacheRotation = ValidateEnvRotation(cache, nullptr, width, height);
+    failures += !Check("rotated CDF cache pdf integral deviation", cacheRotation.maxIntegralError, 1e-2);
+
+    delete[] cache;
+    delete[] alias;
+
+    std::cout << (failures == 0 ? "All environment sampling tests passed" : "Environment sampling tests failed")
+              << std::endl;
+    return failures == 0 ? 0 : 1;
+}